@@ -17,20 +17,30 @@
 /* These types are not visible outside this file.
  * Do NOT move them.
  */
-typedef struct order_list order_list_t;
+typedef struct skip_node skip_node_t;
 
+/* A book is a skip list of its pending orders, best first. Level 0 links
+ * every node in priority order; each higher level links a random subset
+ * of the level below it (a node reaches level i + 1 with probability
+ * 1/2), so a search can skip ahead and booking an order takes expected
+ * O(log n) steps. The best order is always the first node on level 0,
+ * so taking it off the front stays cheap.
+ */
+#define MAX_LEVELS 32
 
-struct order_list {
+struct skip_node {
   order_t *order;
-  order_list_t *next;
+  int levels;             // number of entries in next
+  skip_node_t *next[];    // next node on each level, NULL at the end
 };
 
 struct book {
     enum book_type type;     // BUY_BOOK or SELL_BOOK
-    order_list_t *pending;   // orders still in play.
+    skip_node_t *head;       // sentinel with MAX_LEVELS levels, no order
+    int levels;              // levels in use by some node, at least 1
+    unsigned long long rand_state;  // for node levels
 };
 
-
 /* 
  * order_cmp: Compares two orders. If b1 should come before b2, returns true;
  *
@@ -43,7 +53,7 @@ struct book {
  *  for both cases)
  * 
  * Note: only measuring b1 for being buyer/ seller order because the way
- * that I intend to apply order_cmp is in cases where orders to order_list_t
+ * that I intend to apply order_cmp is in cases where orders in a book
  * are already orginized. This is why there is not any error catching to 
  * be certain that both b1 and b2 are of the same order type 
  * 
@@ -62,60 +72,167 @@ bool order_cmp(order_t *b1, order_t *b2) {
     return b1->time < b2->time;
 }
 
+
 /* 
- * make_order_list: Makes a new node on an order list with the given element 
- * first. Takes an order_list_t to determine what comes behind it
+ * make_skip_node: Makes a new node for an order with the given number of
+ * levels, not yet linked into any list
  *
- * first: first element in a list
- * rest: the list following that element  (if any)
+ * order: the order (NULL for the sentinel)
+ * levels: number of levels the node is on
  * 
- * Returns: List with the first element attached
+ * Returns: the node
  */
-order_list_t *make_order_list(order_t *first, order_list_t *rest) { 
-    order_list_t *lst = (order_list_t*)malloc(sizeof(order_list_t));
-    if (lst == NULL) {
-        fprintf(stderr, "make_intlist: Unable to allocate\n");
+skip_node_t *make_skip_node(order_t *order, int levels) { 
+    skip_node_t *node = (skip_node_t*)malloc(sizeof(skip_node_t) +
+                                             sizeof(skip_node_t*) * levels);
+    if (node == NULL) {
+        fprintf(stderr, "make_skip_node: Unable to allocate\n");
         exit(1);
     }
-    lst->order= first;
-    lst->next = rest;
-    return lst;
+    node->order = order;
+    node->levels = levels;
+    for (int i = 0; i < levels; i++) {
+        node->next[i] = NULL;
+    }
+    return node;
 }
 
 /* 
- * add_to_order_list: Uses make_order_list to add a new node to an existing
- * order_list_t. Uses order_cmp to consider placing. Returns an order list
- * ordered based on if the incoming order is buy or sell
- * returns a new list with the given node if lst is null
- * 
- * lst: pointer to an order_list_t (assumed to be sorted based on applicaiton)
- * inc_order: order to be added to the sorted list
+ * random_levels: Picks how many levels a new node is on: 1, 2, 3, ... 
+ * with probability 1/2, 1/4, 1/8, ... Uses an xorshift generator seeded
+ * per book so runs are repeatable
+ *
+ * book: the book the node is for
  * 
- * Returns: modified and sorted order_list_t
+ * Returns: the number of levels
  */
-order_list_t *add_to_order_list(order_list_t *lst, order_t *inc_order) {
-	if (lst == NULL) {
-		return make_order_list(inc_order, NULL);
-	}
-    order_list_t *head = lst;
-    if(lst->next != NULL && lst->next->order != NULL && 
-        order_cmp(inc_order,lst->next->order)) {
-        lst->next = make_order_list(inc_order, lst->next);
-        return head;
+int random_levels(book_t *book) {
+    book->rand_state ^= book->rand_state << 13;
+    book->rand_state ^= book->rand_state >> 7;
+    book->rand_state ^= book->rand_state << 17;
+    unsigned long long bits = book->rand_state;
+    int levels = 1;
+    while ((bits & 1) && levels < MAX_LEVELS) {
+        levels++;
+        bits >>= 1;
     }
-    order_list_t *prev = lst;
-    while(lst->next != NULL) {
-        lst = lst->next;
-        if (order_cmp(inc_order,lst->order)){
-            prev->next = make_order_list(inc_order, prev->next);
-            return head;
+    return levels;
+}
+
+/* 
+ * find_before: Finds, on every level, the last node that should stay in
+ * front of an order: every order with priority over it, and every order
+ * it does not have priority over (same price and time), stays in front
+ *
+ * book: book to search
+ * order: the order to place
+ * before: out parameter, filled in for levels 0 to book->levels - 1
+ */
+void find_before(book_t *book, order_t *order, skip_node_t *before[]) {
+    skip_node_t *curr = book->head;
+    for (int i = book->levels - 1; i >= 0; i--) {
+        while (curr->next[i] != NULL && 
+            !order_cmp(order, curr->next[i]->order)) {
+            curr = curr->next[i];
         }
-        prev = lst;
+        before[i] = curr;
+    }
+}
+
+/* 
+ * add_to_book: Books an order in the place the sorted list put it, in
+ * expected O(log n)
+ * 
+ * book: book to add to
+ * inc_order: order to be added
+ */
+void add_to_book(book_t *book, order_t *inc_order) {
+    skip_node_t *before[MAX_LEVELS];
+    find_before(book, inc_order, before);
+    int levels = random_levels(book);
+    for (int i = book->levels; i < levels; i++) {
+        before[i] = book->head;
+    }
+    if (levels > book->levels) {
+        book->levels = levels;
+    }
+    skip_node_t *node = make_skip_node(inc_order, levels);
+    for (int i = 0; i < levels; i++) {
+        node->next[i] = before[i]->next[i];
+        before[i]->next[i] = node;
     }
-    lst->next = make_order_list(inc_order, NULL); 
-    return head;
 } 
 
+/* 
+ * unlink_node: Takes a node out of every level it is on and frees it (but
+ * not its order)
+ *
+ * book: the book
+ * node: the node
+ * before: the node in front of it on each of its levels
+ */
+void unlink_node(book_t *book, skip_node_t *node, skip_node_t *before[]) {
+    for (int i = 0; i < node->levels; i++) {
+        before[i]->next[i] = node->next[i];
+    }
+    while (book->levels > 1 && book->head->next[book->levels - 1] == NULL) {
+        book->levels--;
+    }
+    free(node);
+}
+
+/* 
+ * remove_best: Takes the first order off a book. The node in front of it
+ * on every level is the sentinel, so this costs only its level count
+ *
+ * book: a book that is not empty
+ */
+void remove_best(book_t *book) {
+    skip_node_t *best = book->head->next[0];
+    assert(best != NULL);
+    skip_node_t *before[MAX_LEVELS];
+    for (int i = 0; i < best->levels; i++) {
+        before[i] = book->head;
+    }
+    unlink_node(book, best, before);
+}
+
+/* 
+ * remove_from_book: Removes a pending order from a book wherever it is,
+ * in expected O(log n). The order itself is not freed
+ *
+ * book: the book
+ * order: the order to remove
+ *
+ * Returns: true if the order was in the book
+ */
+bool remove_from_book(book_t *book, order_t *order) {
+    skip_node_t *before[MAX_LEVELS];
+    skip_node_t *curr = book->head;
+    for (int i = book->levels - 1; i >= 0; i--) {
+        while (curr->next[i] != NULL && 
+            order_cmp(curr->next[i]->order, order)) {
+            curr = curr->next[i];
+        }
+        before[i] = curr;
+    }
+    // orders with the same price and time may sit in front of this one,
+    // so walk level 0 to it, keeping before up to date
+    skip_node_t *node = before[0]->next[0];
+    while (node != NULL && node->order != order && 
+        !order_cmp(order, node->order)) {
+        for (int i = 0; i < node->levels; i++) {
+            before[i] = node;
+        }
+        node = node->next[0];
+    }
+    if (node == NULL || node->order != order) {
+        return false;
+    }
+    unlink_node(book, node, before);
+    return true;
+}
+
 /* 
  * bookmaker: Creates a new book with an empty order_list 
  *
@@ -130,66 +247,33 @@ book_t *bookmaker(enum book_type val){
         exit(1);
     }
     out->type = val;
-    out->pending = add_to_order_list(NULL, NULL);
+    out->head = make_skip_node(NULL, MAX_LEVELS);
+    out->levels = 1;
+    out->rand_state = 0x2545F4914F6CDD1DULL + val;
     return out;
 }
 
 
 
-/* 
- * free_order_lst: Frees all values in an order_lst
- *
- * lst: list to be freed
- */
-void free_order_lst(order_list_t *lst) {
-    order_list_t *next;
-    while(lst != NULL) {
-        next = lst->next;
-        if (lst->order != NULL){
-            free_order(lst->order);
-            free(lst);
-        }
-        lst = next;
-    }
-}
-
 /* 
  * free_book_lst: Frees all values in a book
  *
  * value: book to be freed
  */
 void free_book_lst(book_t *value){
-    if (value->pending != NULL){
-        free_order_lst(value->pending);        
+    skip_node_t *curr = value->head->next[0];
+    while (curr != NULL) {
+        skip_node_t *next = curr->next[0];
+        free_order(curr->order);
+        free(curr);
+        curr = next;
     }
-    free(value->pending);
+    free(value->head);
     free (value);
 }
 
 
 
-/* 
- * print_order_lst: Prints all values in an order list
- *
- * lst: list to be printed
- */
-void print_order_lst(order_list_t *lst) {
-    if (lst->next != NULL){
-        lst = lst->next;
-    }
-    order_list_t *curr = lst;
-    while (curr != NULL) {
-        if (curr->order != NULL){
-            print_order(curr->order);
-            printf("\n");
-        } else {
-            printf("Order List is Empty\n");
-        }
-        curr = curr->next;
-    }
-}
-
-
 /* 
  * print_contents_of_book: Prints all the contents in a book list
  *
@@ -201,7 +285,14 @@ void print_contents_of_book(book_t *book){
     } else {
         printf("Sell book: \n");
     }
-    print_order_lst(book->pending);
+    skip_node_t *curr = book->head->next[0];
+    if (curr == NULL) {
+        printf("Order List is Empty\n");
+    }
+    for (; curr != NULL; curr = curr->next[0]) {
+        print_order(curr->order);
+        printf("\n");
+    }
 }
 
 
@@ -280,9 +371,9 @@ order_t *update_order_shares(order_t *pend_order, order_t *new_order,
  * 
  * Will compare the order to the opposite book, if there is no match in the 
  * first value (based on check_transaction helper function), 
- * the order will be added to it's own book order list. If the first isn't a 
- * match, none of the values will be, as it is an ordered list set to  
- * maximize transactions 
+ * the order will be added to it's own book. If the first isn't a 
+ * match, none of the values will be, as the book is kept in priority
+ * order 
  * 
  * The returned order will be the given order set to be reported in 
  * Process_order
@@ -300,29 +391,17 @@ order_t *update_order_shares(order_t *pend_order, order_t *new_order,
  */
 order_t *compute_order(book_t *samebook, book_t *oppbook, order_t *order, 
     bool *pendshares) {
-    order_list_t *samelst = samebook->pending;
-    order_list_t *opplst = oppbook->pending;
-    if (opplst->next == NULL ){
-        samebook->pending = add_to_order_list(samelst, order);
+    skip_node_t *best = oppbook->head->next[0];
+    if (best == NULL || !check_transaction(best->order, order)) {
+        add_to_book(samebook, order);
         *pendshares = false;
         return order;
-    } 
-    order_list_t *head = samelst;
-    samelst = samelst->next;
-    order_list_t *prev = opplst;
-    opplst = opplst->next;
+    }
     bool rm_pend = false;
-    if( check_transaction (opplst->order,order)){
-        order_t *upd_order = update_order_shares (opplst->order, order, 
-            pendshares, &rm_pend);
-        if(rm_pend){ 
-            prev->next = opplst->next;
-            free(opplst);     
-        }
-        return upd_order;
-    } else{
-        samebook->pending = add_to_order_list(head, order);
-        *pendshares = false;
-        return order;
+    order_t *upd_order = update_order_shares(best->order, order, 
+        pendshares, &rm_pend);
+    if (rm_pend) {
+        remove_best(oppbook);
     }
-}
\ No newline at end of file
+    return upd_order;
+}
@@ -56,6 +56,17 @@ book_t *bookmaker(enum book_type val);
 order_t *compute_order(book_t *samebook, book_t *oppbook, order_t *order, 
     bool *pendshares);
 
+/* 
+ * remove_from_book: Removes a pending order from a book wherever it is in
+ * the book, in expected O(log n). The order itself is not freed
+ *
+ * book: the book
+ * order: the order to remove
+ *
+ * Returns: true if the order was in the book
+ */
+bool remove_from_book(book_t *book, order_t *order);
+
 /* 
  * free_book_lst: Frees all values in a book
  *
@@ -0,0 +1,169 @@
+/*
+ * CS 152, Spring 2022
+ * Replay: runs an orders file through the exchange
+ *
+ * Usage: replay <orders file> <actions file>
+ *
+ * Each line of the orders file is an order, placed at the time given by
+ * its line number (starting at 0), as simulate in part2 does. The actions
+ * are written in part2's actions file format, so the two exchanges can be
+ * compared (see part2/difftest.c). This exchange has no cancels, so a
+ * cancel in the orders file is an error.
+ *
+ * action_report.c may not be changed, and the only way it shows a
+ * report is print_action_report. So while the orders run, stdout goes
+ * to a temporary file, with each report's printout after a line holding
+ * its time; afterwards that file is turned into the actions file.
+ *
+ * When it is done, replay writes one line to stdout: the number of
+ * orders and the nanoseconds spent processing them and printing their
+ * actions.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "order.h"
+#include "action_report.h"
+#include "exchange.h"
+#include "util.h"
+
+#define MAX_LINE_LEN 1000
+
+/*
+ * read_orders: reads a whole file into memory and splits it into lines
+ *
+ * filename: the file
+ * num_lines: out parameter for the number of lines
+ *
+ * Returns: array of lines (newlines removed) pointing into one buffer,
+ *   which is lines[0]
+ */
+static char **read_orders(char *filename, int *num_lines) {
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "replay: cannot open %s\n", filename);
+        exit(1);
+    }
+    fseek(fp, 0, SEEK_END);
+    long len = ftell(fp);
+    rewind(fp);
+    char *buf = (char *) ck_malloc(len + 1, "read_orders");
+    if (fread(buf, 1, len, fp) != (size_t) len) {
+        fprintf(stderr, "replay: cannot read %s\n", filename);
+        exit(1);
+    }
+    fclose(fp);
+    buf[len] = '\0';
+
+    int n = 0;
+    for (long i = 0; i < len; i++) {
+        if (buf[i] == '\n' || i == len - 1) {
+            n++;
+        }
+    }
+    char **lines = (char **) ck_malloc(sizeof(char *) * (n + 1),
+                                       "read_orders");
+    lines[0] = buf;
+    char *p = buf;
+    for (int i = 0; i < n; i++) {
+        lines[i] = p;
+        p += strcspn(p, "\n");
+        if (*p == '\n') {
+            *p++ = '\0';
+        }
+    }
+    *num_lines = n;
+    return lines;
+}
+
+/*
+ * write_actions: turns what print_action_report printed into the
+ *   actions file format, index,action,oref,price,shares
+ *
+ * printed: the printouts, each after a line with its report's index
+ * fp: the actions file
+ */
+static void write_actions(FILE *printed, FILE *fp) {
+    char line[MAX_LINE_LEN];
+    int index = 0;
+    while (fgets(line, MAX_LINE_LEN, printed) != NULL) {
+        int shares;
+        long long price, oref;
+        char side[5];
+        if (sscanf(line, " %d shares BOOKED (%4[A-Z]) at price %lld (%lld)",
+                   &shares, side, &price, &oref) == 4) {
+            fprintf(fp, "%d,BOOKED_%s,%lld,%lld,%d\n", index, side, oref,
+                    price, shares);
+        } else if (sscanf(line, " %d shares TRADED at price %lld (%lld)",
+                          &shares, &price, &oref) == 3) {
+            fprintf(fp, "%d,EXECUTE,%lld,%lld,%d\n", index, oref, price,
+                    shares);
+        } else if (strncmp(line, "No actions", 10) != 0 &&
+                   sscanf(line, "%d", &index) != 1) {
+            fprintf(stderr, "replay: cannot read report line: %s", line);
+            exit(1);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: replay <orders file> <actions file>\n");
+        exit(1);
+    }
+    int num_lines;
+    char **lines = read_orders(argv[1], &num_lines);
+    for (int i = 0; i < num_lines; i++) {
+        char *type = strchr(lines[i], ',');
+        type = type == NULL ? NULL : strchr(type + 1, ',');
+        if (type == NULL || type[1] != 'A') {
+            fprintf(stderr, "replay: line %d is not an add: %s\n", i + 1,
+                    lines[i]);
+            exit(1);
+        }
+    }
+    FILE *fp = fopen(argv[2], "w");
+    FILE *printed = tmpfile();
+    if (fp == NULL || printed == NULL) {
+        fprintf(stderr, "replay: cannot write %s\n", argv[2]);
+        exit(1);
+    }
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    dup2(fileno(printed), STDOUT_FILENO);
+
+    exchange_t *exchange = mk_exchange("REPLAY");
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < num_lines; i++) {
+        action_report_t *ar = process_order(exchange, lines[i], i);
+        printf("%d\n", i);
+        print_action_report(ar);
+        free_action_report(ar);
+    }
+    fflush(stdout);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) * 1e9 +
+                     (end.tv_nsec - start.tv_nsec);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    rewind(printed);
+    write_actions(printed, fp);
+    printf("%d,%.0f\n", num_lines, elapsed);
+
+    fclose(printed);
+    fclose(fp);
+    free_exchange(exchange);
+    ck_free(lines[0]);
+    ck_free(lines);
+    return 0;
+}
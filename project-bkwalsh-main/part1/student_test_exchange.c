@@ -10,6 +10,7 @@
 #include <stdio.h>
 
 #include "order.h"
+#include "book.h"
 #include "action_report.h"
 #include "exchange.h"
 #include "util.h"
@@ -210,6 +211,61 @@ void do_handout() {
 
 
 
+/* do_skip_list: book buys at a few prices and repeated times, remove some
+ *  from the middle of the book, then sell into the book one order at a
+ *  time and check the buys come back out in priority order with none
+ *  missing.
+ */
+void do_skip_list() {
+    int num_orders = 2000;
+    book_t *buys = bookmaker(BUY_BOOK);
+    book_t *sells = bookmaker(SELL_BOOK);
+    order_t *orders[num_orders];
+    for (int i = 0; i < num_orders; i++) {
+        bool pendshares;
+        orders[i] = mk_order('I', "UOCCS", 'A', 'B', 10, 
+                             550000 + (i * 7919) % 37 * 100, i, i / 3);
+        order_t *out = compute_order(buys, sells, orders[i], &pendshares);
+        assert(out == orders[i] && !pendshares);
+    }
+    int removed = 0;
+    for (int i = 0; i < num_orders; i += 5) {
+        assert(remove_from_book(buys, orders[i]));
+        assert(!remove_from_book(buys, orders[i]));
+        free_order(orders[i]);
+        removed++;
+    }
+
+    order_t *prev = NULL;
+    int taken = 0;
+    while (true) {
+        bool pendshares;
+        order_t *sell = mk_order('I', "UOCCS", 'A', 'S', 1000000, 1, -1, 
+                                 num_orders);
+        order_t *out = compute_order(sells, buys, sell, &pendshares);
+        if (out == sell) {
+            // the buy book is empty, so the sell was booked
+            assert(!pendshares);
+            break;
+        }
+        assert(pendshares && out->oref % 5 != 0);
+        assert(prev == NULL || out->price < prev->price ||
+               (out->price == prev->price && out->time >= prev->time));
+        if (prev != NULL) {
+            free_order(prev);
+        }
+        prev = out;
+        free_order(sell);
+        taken++;
+    }
+    free_order(prev);
+    assert(taken + removed == num_orders);
+    printf("skip list keeps price-time priority\n");
+    free_book_lst(buys);
+    free_book_lst(sells);
+}
+
+
 int main() {
     // uncomment to check exchange constructor and free before trying
     // any orders.
@@ -220,6 +276,8 @@ int main() {
   // do_sells();
     // uncomment to process all the samples order
      do_all();
+
+    do_skip_list();
   //  do_handout();
 }
 
@@ -0,0 +1,65 @@
+/*
+ * CS 152, Spring 2022
+ * Binary Action Log Format
+ *
+ * Fields are written a byte at a time so the format is the same on any
+ * machine and records need no alignment.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "action_report.h"
+#include "action_log.h"
+
+/*
+ * put_le: write the low len bytes of a value, least significant first
+ */
+static void put_le(unsigned char *buf, uint64_t value, int len) {
+    for (int i = 0; i < len; i++) {
+        buf[i] = value >> (8 * i);
+    }
+}
+
+/*
+ * get_le: read a len byte little-endian value
+ */
+static uint64_t get_le(const unsigned char *buf, int len) {
+    uint64_t value = 0;
+    for (int i = len - 1; i >= 0; i--) {
+        value = (value << 8) | buf[i];
+    }
+    return value;
+}
+
+/*
+ * encode_action_record: write a record in the log format
+ *
+ * buf: room for ACTION_LOG_RECORD_LEN bytes
+ * rec: the action
+ */
+void encode_action_record(unsigned char *buf, const action_record_t *rec) {
+    put_le(buf, (uint32_t) rec->index, 4);
+    buf[4] = rec->action;
+    put_le(buf + 5, (uint32_t) rec->shares, 4);
+    put_le(buf + 9, (uint64_t) rec->oref, 8);
+    put_le(buf + 17, (uint64_t) rec->price, 8);
+}
+
+/*
+ * decode_action_record: read a record in the log format
+ *
+ * buf: ACTION_LOG_RECORD_LEN bytes of a log
+ * rec: out parameter, the action
+ *
+ * Returns: false if the record's action is not valid
+ */
+bool decode_action_record(const unsigned char *buf, action_record_t *rec) {
+    rec->index = (int32_t) get_le(buf, 4);
+    rec->action = buf[4];
+    rec->shares = (int32_t) get_le(buf + 5, 4);
+    rec->oref = (int64_t) get_le(buf + 9, 8);
+    rec->price = (int64_t) get_le(buf + 17, 8);
+    return buf[4] <= CANCEL_SELL;
+}
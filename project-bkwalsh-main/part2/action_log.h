@@ -0,0 +1,56 @@
+/*
+ * CS 152, Spring 2022
+ * Binary Action Log Format.
+ *
+ * A binary action log is the 8 byte magic ACTION_LOG_MAGIC followed by
+ * one fixed size record per action, in the order the actions happened.
+ * Each record is ACTION_LOG_RECORD_LEN bytes, little-endian, with no
+ * padding:
+ *
+ *   bytes  0-3   index of the order (uint32)
+ *   byte   4     action (enum action)
+ *   bytes  5-8   shares (int32)
+ *   bytes  9-16  oref (int64)
+ *   bytes 17-24  price (int64)
+ *
+ * That is 25 bytes for an action that takes 30-45 bytes as text, and
+ * reading it back needs no parsing. action_writer.h writes logs, and
+ * actlog converts them back to the CSV format.
+ */
+
+#ifndef ACTION_LOG_H
+#define ACTION_LOG_H
+
+#include "action_report.h"
+
+#define ACTION_LOG_MAGIC "CS152AL1"
+#define ACTION_LOG_MAGIC_LEN 8
+#define ACTION_LOG_RECORD_LEN 25
+
+typedef struct action_record {
+    long long oref;
+    long long price;
+    int index;
+    int shares;
+    enum action action;
+} action_record_t;
+
+/*
+ * encode_action_record: write a record in the log format
+ *
+ * buf: room for ACTION_LOG_RECORD_LEN bytes
+ * rec: the action
+ */
+void encode_action_record(unsigned char *buf, const action_record_t *rec);
+
+/*
+ * decode_action_record: read a record in the log format
+ *
+ * buf: ACTION_LOG_RECORD_LEN bytes of a log
+ * rec: out parameter, the action
+ *
+ * Returns: false if the record's action is not valid
+ */
+bool decode_action_record(const unsigned char *buf, action_record_t *rec);
+
+#endif
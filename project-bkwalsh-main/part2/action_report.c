@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "action_report.h"
 #include "util.h"
@@ -28,6 +29,7 @@ struct action_report {
     int num_actions;   // the number of actions recorded
     int num_slots;    // the number of slots in the array
     action_t *actions;  // an array of struct actions
+    int ticker_slots;   // bytes allocated for ticker
 };
 
 #define INIT_SLOTS 2
@@ -46,6 +48,7 @@ action_report_t *mk_action_report(char *ticker) {
       (action_report_t *) ck_malloc(sizeof(action_report_t), 
 				    fn_name);
     ar->ticker = ck_strdup(ticker, fn_name);
+    ar->ticker_slots = strlen(ticker) + 1;
     ar->num_actions = 0;
     ar->num_slots = INIT_SLOTS;
     ar->actions = (action_t *) ck_malloc(sizeof(action_t) * INIT_SLOTS, 
@@ -67,6 +70,29 @@ void free_action_report(action_report_t *ar) {
     ck_free(ar);
 }
 
+/*
+ * reset_action_report: empty an action report so it can be used again
+ *
+ * ar: the action report
+ * ticker: the ticker symbol for the report
+ */
+void reset_action_report(action_report_t *ar, char *ticker) {
+    assert(ar != NULL);
+    assert(ticker != NULL);
+
+    ar->num_actions = 0;
+    if (strcmp(ar->ticker, ticker) == 0) {
+        return;
+    }
+    int len = strlen(ticker);
+    if (len + 1 > ar->ticker_slots) {
+        ck_free(ar->ticker);
+        ar->ticker = (char *) ck_malloc(len + 1, "reset_action_report");
+        ar->ticker_slots = len + 1;
+    }
+    memcpy(ar->ticker, ticker, len + 1);
+}
+
 /*
  * add_action: add an action to the report
  *
@@ -102,6 +128,45 @@ void add_action(action_report_t *ar, enum action action,
     ar->num_actions++;
 }
 
+/*
+ * num_actions_in_report: the number of actions in a report
+ *
+ * ar: the action report
+ */
+int num_actions_in_report(action_report_t *ar) {
+    assert(ar != NULL);
+    return ar->num_actions;
+}
+
+/*
+ * action_report_ticker: the ticker symbol of a report
+ *
+ * ar: the action report
+ *
+ * Returns: the report's own copy of the ticker
+ */
+char *action_report_ticker(action_report_t *ar) {
+    assert(ar != NULL);
+    return ar->ticker;
+}
+
+/*
+ * get_action: read one action from a report
+ *
+ * ar: the action report
+ * i: which action, from 0 to num_actions_in_report(ar) - 1
+ * action, oref, price, shares: out parameters, the action's fields
+ */
+void get_action(action_report_t *ar, int i, enum action *action,
+                long long *oref, long long *price, int *shares) {
+    assert(ar != NULL);
+    assert(i >= 0 && i < ar->num_actions);
+    *action = ar->actions[i].action;
+    *oref = ar->actions[i].oref;
+    *price = ar->actions[i].price;
+    *shares = ar->actions[i].shares;
+}
+
 /*
  * print_action_report: print the contents of the action report
  *
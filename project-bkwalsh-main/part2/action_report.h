@@ -37,6 +37,18 @@ action_report_t *mk_action_report(char *ticker);
 void free_action_report(action_report_t *ar);
 
 
+/*
+ * reset_action_report: empty an action report so it can be used again.
+ *   The report keeps the space it has grown for actions and for its
+ *   copy of the ticker, so reusing a report does not allocate once it
+ *   has seen its longest ticker and its largest number of actions.
+ *
+ * ar: the action report
+ * ticker: the ticker symbol for the report
+ */
+void reset_action_report(action_report_t *ar, char *ticker);
+
+
 /*
  * add_action: add a action to the report
  *
@@ -49,6 +61,35 @@ void add_action(action_report_t *ar, enum action action,
 		long long oref, long long price, int num_shares);
 
 
+/*
+ * num_actions_in_report: the number of actions in a report
+ *
+ * ar: the action report
+ */
+int num_actions_in_report(action_report_t *ar);
+
+
+/*
+ * action_report_ticker: the ticker symbol of a report
+ *
+ * ar: the action report
+ *
+ * Returns: the report's own copy of the ticker
+ */
+char *action_report_ticker(action_report_t *ar);
+
+
+/*
+ * get_action: read one action from a report
+ *
+ * ar: the action report
+ * i: which action, from 0 to num_actions_in_report(ar) - 1
+ * action, oref, price, shares: out parameters, the action's fields
+ */
+void get_action(action_report_t *ar, int i, enum action *action,
+                long long *oref, long long *price, int *shares);
+
+
 /*
  * print_action_report: print the contents of the action report
  *
@@ -0,0 +1,50 @@
+/*
+ * CS 152, Spring 2022
+ * Action Sinks
+ */
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "action_report.h"
+#include "action_sink.h"
+
+/*
+ * add_to_report: action_fn for report_sink
+ */
+static void add_to_report(void *ctx, int time, enum action action,
+                          long long oref, long long price, int shares) {
+    add_action((action_report_t *) ctx, action, oref, price, shares);
+}
+
+/*
+ * report_sink: a sink that adds each action to an action report
+ *
+ * ar: the action report
+ *
+ * Returns: the sink
+ */
+action_sink_t report_sink(action_report_t *ar) {
+    action_sink_t sink = {add_to_report, ar};
+    return sink;
+}
+
+/*
+ * replay_action_report: pass every action in a report to a sink, in order
+ *
+ * ar: the action report
+ * sink: the sink
+ * time: the time to give the sink for each action
+ */
+void replay_action_report(action_report_t *ar, action_sink_t *sink, 
+                          int time) {
+    assert(ar != NULL);
+    int n = num_actions_in_report(ar);
+    for (int i = 0; i < n; i++) {
+        enum action action;
+        long long oref, price;
+        int shares;
+        get_action(ar, i, &action, &oref, &price, &shares);
+        sink->on_action(sink->ctx, time, action, oref, price, shares);
+    }
+}
@@ -0,0 +1,53 @@
+/*
+ * CS 152, Spring 2022
+ * Action Sink Interface.
+ *
+ * An action sink is told about each action the moment the exchange
+ * takes it, in the order they happen, so a consumer can see the actions
+ * without them being collected into an action report first. Action
+ * reports are filled through a sink too (see report_sink).
+ */
+
+#ifndef ACTION_SINK_H
+#define ACTION_SINK_H
+
+#include "action_report.h"
+
+/*
+ * action_fn: called once for each action
+ *
+ * ctx: the sink's context
+ * time: the time of the order that caused the action
+ * action: what happened
+ * oref: the oref of the order acted on
+ * price: the price of the action
+ * shares: the number of shares
+ */
+typedef void (*action_fn)(void *ctx, int time, enum action action,
+                          long long oref, long long price, int shares);
+
+typedef struct action_sink {
+    action_fn on_action;
+    void *ctx;
+} action_sink_t;
+
+/*
+ * report_sink: a sink that adds each action to an action report
+ *
+ * ar: the action report
+ *
+ * Returns: the sink
+ */
+action_sink_t report_sink(action_report_t *ar);
+
+/*
+ * replay_action_report: pass every action in a report to a sink, in order
+ *
+ * ar: the action report
+ * sink: the sink
+ * time: the time to give the sink for each action
+ */
+void replay_action_report(action_report_t *ar, action_sink_t *sink, 
+                          int time);
+
+#endif
@@ -0,0 +1,200 @@
+/*
+ * CS 152, Spring 2022
+ * Action Writer
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "action_report.h"
+#include "action_sink.h"
+#include "action_log.h"
+#include "action_writer.h"
+#include "util.h"
+
+#define BUFFER_SIZE (1 << 20)
+#define MAX_LINE_LEN 96         // longest possible line, with room to spare
+
+struct action_writer {
+    int fd;
+    bool binary;                // write action_log.h records, not text
+    int len;                    // bytes waiting in buf
+    char buf[BUFFER_SIZE];
+};
+
+/* ",NAME," for each action, indexed by enum action */
+static const char *action_names[] = {",BOOKED_BUY,", ",BOOKED_SELL,",
+                                     ",EXECUTE,", ",CANCEL_BUY,",
+                                     ",CANCEL_SELL,"};
+static const int action_name_lens[] = {12, 13, 9, 12, 13};
+
+/* "00" "01" ... "99", so digits can be written two at a time */
+static const char digit_pairs[] =
+    "000102030405060708091011121314151617181920212223242526272829"
+    "303132333435363738394041424344454647484950515253545556575859"
+    "606162636465666768697071727374757677787980818283848586878889"
+    "90919293949596979899";
+
+/*
+ * put_int: write a number in decimal, as printf's %lld would
+ *
+ * p: where to write
+ *
+ * Returns: the position just past the digits
+ */
+static char *put_int(char *p, long long value) {
+    unsigned long long v = value;
+    if (value < 0) {
+        *p++ = '-';
+        v = -v;
+    }
+    char digits[20];
+    char *d = digits + sizeof(digits);
+    while (v >= 100) {
+        int pair = (v % 100) * 2;
+        v /= 100;
+        *--d = digit_pairs[pair + 1];
+        *--d = digit_pairs[pair];
+    }
+    if (v >= 10) {
+        *--d = digit_pairs[v * 2 + 1];
+        *--d = digit_pairs[v * 2];
+    } else {
+        *--d = '0' + v;
+    }
+    int n = digits + sizeof(digits) - d;
+    memcpy(p, d, n);
+    return p + n;
+}
+
+/*
+ * mk_action_writer: make a writer for a file descriptor
+ *
+ * fd: an open file descriptor
+ *
+ * Returns: a writer
+ */
+action_writer_t *mk_action_writer(int fd) {
+    action_writer_t *w = (action_writer_t *) 
+        ck_malloc(sizeof(action_writer_t), "mk_action_writer");
+    w->fd = fd;
+    w->binary = false;
+    w->len = 0;
+    return w;
+}
+
+/*
+ * mk_action_log_writer: make a writer that writes a binary action log
+ *
+ * fd: an open file descriptor
+ *
+ * Returns: a writer
+ */
+action_writer_t *mk_action_log_writer(int fd) {
+    action_writer_t *w = mk_action_writer(fd);
+    w->binary = true;
+    memcpy(w->buf, ACTION_LOG_MAGIC, ACTION_LOG_MAGIC_LEN);
+    w->len = ACTION_LOG_MAGIC_LEN;
+    return w;
+}
+
+/*
+ * free_action_writer: flush a writer and free it
+ *
+ * w: the writer
+ */
+void free_action_writer(action_writer_t *w) {
+    flush_action_writer(w);
+    ck_free(w);
+}
+
+/*
+ * flush_action_writer: write out everything in the buffer
+ *
+ * w: the writer
+ */
+void flush_action_writer(action_writer_t *w) {
+    char *p = w->buf;
+    while (w->len > 0) {
+        ssize_t n = write(w->fd, p, w->len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("flush_action_writer");
+            exit(1);
+        }
+        p += n;
+        w->len -= n;
+    }
+}
+
+/*
+ * writer_add_action: write one action
+ *
+ * w: the writer
+ * index: the number at the start of the line
+ * action, oref, price, shares: the action
+ */
+void writer_add_action(action_writer_t *w, int index, enum action action,
+                       long long oref, long long price, int shares) {
+    assert(action >= BOOKED_BUY && action <= CANCEL_SELL);
+    if (w->len > BUFFER_SIZE - MAX_LINE_LEN) {
+        flush_action_writer(w);
+    }
+    if (w->binary) {
+        action_record_t rec = {oref, price, index, shares, action};
+        encode_action_record((unsigned char *) w->buf + w->len, &rec);
+        w->len += ACTION_LOG_RECORD_LEN;
+        return;
+    }
+    char *p = w->buf + w->len;
+    p = put_int(p, index);
+    memcpy(p, action_names[action], action_name_lens[action]);
+    p += action_name_lens[action];
+    p = put_int(p, oref);
+    *p++ = ',';
+    p = put_int(p, price);
+    *p++ = ',';
+    p = put_int(p, shares);
+    *p++ = '\n';
+    w->len = p - w->buf;
+}
+
+/*
+ * add_to_writer: action_fn for writer_sink
+ */
+static void add_to_writer(void *ctx, int time, enum action action,
+                          long long oref, long long price, int shares) {
+    writer_add_action((action_writer_t *) ctx, time, action, oref, price,
+                      shares);
+}
+
+/*
+ * writer_sink: a sink that writes each action
+ *
+ * w: the writer
+ *
+ * Returns: the sink
+ */
+action_sink_t writer_sink(action_writer_t *w) {
+    action_sink_t sink = {add_to_writer, w};
+    return sink;
+}
+
+/*
+ * writer_add_report: write every action in a report
+ *
+ * w: the writer
+ * ar: the report
+ * index: the number at the start of each line
+ */
+void writer_add_report(action_writer_t *w, action_report_t *ar, int index) {
+    action_sink_t sink = writer_sink(w);
+    replay_action_report(ar, &sink, index);
+}
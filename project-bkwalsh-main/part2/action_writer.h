@@ -0,0 +1,92 @@
+/*
+ * CS 152, Spring 2022
+ * Action Writer Interface.
+ *
+ * Writes actions in the same format as write_action_report_to_file,
+ * one per line:
+ *
+ *   index,ACTION,oref,price,shares
+ *
+ * The lines are built in a large buffer with a hand-written integer
+ * conversion and action names that are ready to copy, and the buffer
+ * goes to the file descriptor in one write when it fills. Nothing goes
+ * through stdio, so do not mix a writer with FILE output to the same
+ * file without flushing the writer first.
+ *
+ * A writer made by mk_action_log_writer writes the binary action log
+ * format (action_log.h) instead.
+ */
+
+#ifndef ACTION_WRITER_H
+#define ACTION_WRITER_H
+
+#include "action_report.h"
+#include "action_sink.h"
+
+/* The writer type is opaque */
+typedef struct action_writer action_writer_t;
+
+/*
+ * mk_action_writer: make a writer for a file descriptor
+ *
+ * fd: an open file descriptor. It is not closed with the writer.
+ *
+ * Returns: a writer
+ */
+action_writer_t *mk_action_writer(int fd);
+
+/*
+ * mk_action_log_writer: make a writer that writes a binary action log to
+ *   a file descriptor, starting with the log's magic
+ *
+ * fd: an open file descriptor. It is not closed with the writer.
+ *
+ * Returns: a writer
+ */
+action_writer_t *mk_action_log_writer(int fd);
+
+/*
+ * free_action_writer: flush a writer and free it
+ *
+ * w: the writer
+ */
+void free_action_writer(action_writer_t *w);
+
+/*
+ * writer_add_action: write one action
+ *
+ * w: the writer
+ * index: the number at the start of the line
+ * action, oref, price, shares: the action
+ */
+void writer_add_action(action_writer_t *w, int index, enum action action,
+                       long long oref, long long price, int shares);
+
+/*
+ * writer_add_report: write every action in a report, like
+ *   write_action_report_to_file
+ *
+ * w: the writer
+ * ar: the report
+ * index: the number at the start of each line
+ */
+void writer_add_report(action_writer_t *w, action_report_t *ar, int index);
+
+/*
+ * writer_sink: a sink that writes each action, using the order's time
+ *   as the index
+ *
+ * w: the writer
+ *
+ * Returns: the sink
+ */
+action_sink_t writer_sink(action_writer_t *w);
+
+/*
+ * flush_action_writer: write out everything in the buffer
+ *
+ * w: the writer
+ */
+void flush_action_writer(action_writer_t *w);
+
+#endif
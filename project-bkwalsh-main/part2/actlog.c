@@ -0,0 +1,128 @@
+/*
+ * CS 152, Spring 2022
+ * Action Log Converter
+ *
+ * Turns a binary action log written by simulate -b back into the text
+ * format of write_action_report_to_file, so it can be compared with the
+ * expected results:
+ *
+ *   ./simulate -b -m tests/test9_orders.csv test9.bin
+ *   ./actlog test9.bin - | diff - tests/test9_actions_expected.csv
+ *
+ * Use - for stdin or stdout.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "action_report.h"
+#include "action_log.h"
+#include "action_writer.h"
+#include "util.h"
+
+#define READ_RECORDS 65536      // records read at a time
+
+/*
+ * read_full: read until the buffer is full or the input ends
+ *
+ * Returns: the number of bytes read
+ */
+static size_t read_full(int fd, unsigned char *buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = read(fd, buf + got, len - got);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            fprintf(stderr, "actlog: read failed: %s\n", strerror(errno));
+            exit(1);
+        }
+        if (n == 0) {
+            break;
+        }
+        got += n;
+    }
+    return got;
+}
+
+/*
+ * convert: copy every record of a binary action log to a writer
+ *
+ * in: file descriptor of the log
+ * w: a text action writer
+ *
+ * Returns: the number of actions
+ */
+static long convert(int in, action_writer_t *w) {
+    unsigned char magic[ACTION_LOG_MAGIC_LEN];
+    if (read_full(in, magic, ACTION_LOG_MAGIC_LEN) != ACTION_LOG_MAGIC_LEN ||
+        memcmp(magic, ACTION_LOG_MAGIC, ACTION_LOG_MAGIC_LEN) != 0) {
+        fprintf(stderr, "actlog: not a binary action log\n");
+        exit(1);
+    }
+    size_t size = (size_t) READ_RECORDS * ACTION_LOG_RECORD_LEN;
+    unsigned char *buf = (unsigned char *) ck_malloc(size, "convert");
+    long num_actions = 0;
+    size_t got;
+    while ((got = read_full(in, buf, size)) > 0) {
+        if (got % ACTION_LOG_RECORD_LEN != 0) {
+            fprintf(stderr, "actlog: log ends part way through a record\n");
+            exit(1);
+        }
+        for (size_t i = 0; i < got; i += ACTION_LOG_RECORD_LEN) {
+            action_record_t rec;
+            if (!decode_action_record(buf + i, &rec)) {
+                fprintf(stderr, "actlog: bad action in record %ld\n",
+                        num_actions);
+                exit(1);
+            }
+            writer_add_action(w, rec.index, rec.action, rec.oref, rec.price,
+                              rec.shares);
+            num_actions++;
+        }
+    }
+    ck_free(buf);
+    return num_actions;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: actlog <binary action log> <actions file>\n");
+        fprintf(stderr, "  Use - for stdin or stdout.\n");
+        exit(1);
+    }
+    int in = STDIN_FILENO;
+    if (strcmp(argv[1], "-") != 0) {
+        in = open(argv[1], O_RDONLY);
+        if (in < 0) {
+            fprintf(stderr, "actlog: cannot open %s\n", argv[1]);
+            exit(1);
+        }
+    }
+    int out = STDOUT_FILENO;
+    if (strcmp(argv[2], "-") != 0) {
+        out = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out < 0) {
+            fprintf(stderr, "actlog: cannot write %s\n", argv[2]);
+            exit(1);
+        }
+    }
+    action_writer_t *w = mk_action_writer(out);
+    convert(in, w);
+    free_action_writer(w);
+    if (out != STDOUT_FILENO) {
+        close(out);
+    }
+    if (in != STDIN_FILENO) {
+        close(in);
+    }
+    return 0;
+}
@@ -0,0 +1,514 @@
+/*
+ * CS 152, Spring 2022
+ * Bulk Order Parsing Implementation
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+#include "order.h"
+#include "batch_parse.h"
+#include "symbols.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+/* The buffer is scanned this many bytes at a time, so the separator
+ * masks for one window fit on the stack. A multiple of BLOCK.
+ */
+#define WINDOW 16384
+
+/* The scan records separators as one bit per byte, BLOCK bytes to a word */
+#define BLOCK 64
+#define NUM_BLOCKS (WINDOW / BLOCK)
+
+/* A line has exactly this many commas */
+#define NUM_COMMAS 6
+
+/* Digit runs at most this long cannot overflow a long long */
+#define SAFE_DIGITS 18
+
+typedef void (*scan_fn)(const char *buf, int len, uint64_t *commas,
+                        uint64_t *newlines);
+
+/*
+ * load_word: the 8 bytes at p as a word, first byte lowest
+ */
+static inline uint64_t load_word(const char *p) {
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    return w;
+}
+
+/*
+ * byte_mask: which bytes of a word equal a byte, one bit per byte. The
+ *   matching bytes are found with the usual zero byte test on w ^ the
+ *   byte repeated, whose high bits are then gathered by one multiply.
+ *
+ * w: 8 bytes, first byte lowest
+ * ones: the byte to look for, repeated 8 times
+ *
+ * Returns: bit i set if byte i of w is the byte
+ */
+static inline uint64_t byte_mask(uint64_t w, uint64_t ones) {
+    const uint64_t low7 = 0x7F7F7F7F7F7F7F7FULL;
+    uint64_t x = w ^ ones;
+    uint64_t zero = ~(((x & low7) + low7) | x | low7);
+    return ((zero >> 7) * 0x0102040810204080ULL) >> 56;
+}
+
+/*
+ * scan_scalar: marks every comma and newline in buf. Bit i of word b of
+ *   a mask is set if byte b * BLOCK + i is that separator. The words
+ *   past the end of buf, up to a whole block, are zero. Whole words are
+ *   tested at a time, then any bytes left over one by one.
+ *
+ * buf: bytes to scan
+ * len: number of bytes
+ * commas: out parameter, the comma mask
+ * newlines: out parameter, the newline mask
+ */
+static void scan_scalar(const char *buf, int len, uint64_t *commas,
+                        uint64_t *newlines) {
+    for (int b = 0; b * BLOCK < len; b++) {
+        uint64_t c = 0;
+        uint64_t nl = 0;
+        int block_len = len - b * BLOCK < BLOCK ? len - b * BLOCK : BLOCK;
+        const char *p = buf + b * BLOCK;
+        int i = 0;
+        for (; i + 8 <= block_len; i += 8) {
+            uint64_t w = load_word(p + i);
+            c |= byte_mask(w, 0x2C2C2C2C2C2C2C2CULL) << i;
+            nl |= byte_mask(w, 0x0A0A0A0A0A0A0A0AULL) << i;
+        }
+        for (; i < block_len; i++) {
+            c |= (uint64_t) (p[i] == ',') << i;
+            nl |= (uint64_t) (p[i] == '\n') << i;
+        }
+        commas[b] = c;
+        newlines[b] = nl;
+    }
+}
+
+#ifdef HAVE_X86_SIMD
+/*
+ * scan_sse2: scan_scalar, 16 bytes per compare
+ */
+__attribute__((target("sse2")))
+static void scan_sse2(const char *buf, int len, uint64_t *commas,
+                      uint64_t *newlines) {
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    int b = 0;
+    for (; (b + 1) * BLOCK <= len; b++) {
+        uint64_t c = 0;
+        uint64_t nl = 0;
+        for (int i = 0; i < BLOCK; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *) 
+                                        (buf + b * BLOCK + i));
+            c |= (uint64_t) (unsigned int) 
+                _mm_movemask_epi8(_mm_cmpeq_epi8(v, comma)) << i;
+            nl |= (uint64_t) (unsigned int)
+                _mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)) << i;
+        }
+        commas[b] = c;
+        newlines[b] = nl;
+    }
+    scan_scalar(buf + b * BLOCK, len - b * BLOCK, commas + b, newlines + b);
+}
+
+/*
+ * scan_avx2: scan_scalar, 32 bytes per compare
+ */
+__attribute__((target("avx2")))
+static void scan_avx2(const char *buf, int len, uint64_t *commas,
+                      uint64_t *newlines) {
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    int b = 0;
+    for (; (b + 1) * BLOCK <= len; b++) {
+        const char *p = buf + b * BLOCK;
+        __m256i lo = _mm256_loadu_si256((const __m256i *) p);
+        __m256i hi = _mm256_loadu_si256((const __m256i *) (p + 32));
+        commas[b] = (uint64_t) (unsigned int) 
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, comma)) |
+            (uint64_t) (unsigned int) 
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, comma)) << 32;
+        newlines[b] = (uint64_t) (unsigned int) 
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline)) |
+            (uint64_t) (unsigned int) 
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline)) << 32;
+    }
+    scan_scalar(buf + b * BLOCK, len - b * BLOCK, commas + b, newlines + b);
+}
+#endif
+
+// the scan in use; NULL until the first batch picks the best one
+static scan_fn scan = NULL;
+
+/*
+ * best_batch_isa: the fastest separator scan this CPU supports
+ */
+enum batch_isa best_batch_isa() {
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return BATCH_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return BATCH_SSE2;
+    }
+#endif
+    return BATCH_SCALAR;
+}
+
+/*
+ * set_batch_isa: pick the separator scan parse_order_batch uses. By
+ *   default it uses best_batch_isa().
+ *
+ * isa: the scan to use; must be supported by this CPU
+ */
+void set_batch_isa(enum batch_isa isa) {
+    assert(isa <= best_batch_isa());
+    switch (isa) {
+#ifdef HAVE_X86_SIMD
+    case BATCH_AVX2:
+        scan = scan_avx2;
+        return;
+    case BATCH_SSE2:
+        scan = scan_sse2;
+        return;
+#endif
+    default:
+        scan = scan_scalar;
+    }
+}
+
+/*
+ * batch_isa_str: the name of a separator scan
+ *
+ * Returns: a constant string
+ */
+const char *batch_isa_str(enum batch_isa isa) {
+    switch (isa) {
+    case BATCH_AVX2:
+        return "avx2";
+    case BATCH_SSE2:
+        return "sse2";
+    case BATCH_SCALAR:
+        return "scalar";
+    }
+    return "unknown";
+}
+
+/* Tickers seen in this batch, so orders skip the symbol table for a
+ * ticker already looked up. Tickers of up to 8 characters are kept as
+ * their bytes packed into a word, so a lookup is one hash and one
+ * compare. Slots are overwritten on collision.
+ */
+#define TICKER_SLOTS 64
+#define TICKER_SLOT_BITS 6
+
+typedef struct ticker_slot {
+    uint64_t key;               // the ticker's bytes
+    int len;                    // 0 for an empty slot
+    int symbol;
+} ticker_slot_t;
+
+/*
+ * eight_digits: reads a run of 1 to 8 digits without a loop. The run is
+ *   shifted to the top of a word with '0's in front of it, checked to be
+ *   all digits, and turned into a number with three multiplies that
+ *   each combine neighbouring digits, then pairs, then fours.
+ *
+ * p: first digit; 8 bytes must be readable from here
+ * len: number of characters, 1 to 8
+ * out: out parameter for the value
+ *
+ * Returns: true if the run was all digits
+ */
+static inline bool eight_digits(const char *p, int len, long long *out) {
+    const uint64_t zeros = 0x3030303030303030ULL;
+    const uint64_t high = 0xF0F0F0F0F0F0F0F0ULL;
+    uint64_t w = load_word(p) << (8 * (8 - len));
+    w |= zeros >> (8 * len - 1) >> 1;
+    if (((w & high) ^ zeros) | (((w + 0x0606060606060606ULL) & high) ^ zeros)) {
+        return false;
+    }
+    w -= zeros;
+    w = (w * 10 + (w >> 8)) & 0x00FF00FF00FF00FFULL;
+    w = (w * 100 + (w >> 16)) & 0x0000FFFF0000FFFFULL;
+    w = (w * 10000 + (w >> 32)) & 0xFFFFFFFFULL;
+    *out = (long long) w;
+    return true;
+}
+
+/*
+ * digits_value: reads a run of digits whose length is already known
+ *
+ * p: first digit
+ * len: number of characters, at most SAFE_DIGITS
+ * limit: end of the buffer; no byte at or past it is read
+ * out: out parameter for the value
+ *
+ * Returns: true if the run was non-empty and all digits
+ */
+static inline bool digits_value(const char *p, int len, const char *limit,
+                                long long *out) {
+    if (len <= 0 || len > SAFE_DIGITS) {
+        return false;
+    }
+    if (len <= 16 && limit - p >= 8) {
+        if (len <= 8) {
+            return eight_digits(p, len, out);
+        }
+        long long top, bottom;
+        if (!eight_digits(p, len - 8, &top) ||
+            !eight_digits(p + len - 8, 8, &bottom)) {
+            return false;
+        }
+        *out = top * 100000000 + bottom;
+        return true;
+    }
+    // a long run, or too near the end of the buffer to read whole words
+    long long n = 0;
+    for (int i = 0; i < len; i++) {
+        unsigned int digit = (unsigned char) p[i] - '0';
+        if (digit > 9) {
+            return false;
+        }
+        n = n * 10 + digit;
+    }
+    *out = n;
+    return true;
+}
+
+/*
+ * ticker_symbol: the id of a ticker, from the batch's ticker slots when
+ *   it has been seen and from the symbol table otherwise
+ *
+ * ticker: first character of the ticker
+ * len: its length
+ * limit: end of the buffer; no byte at or past it is read
+ * slots: in/out, the batch's TICKER_SLOTS ticker slots
+ *
+ * Returns: the interned id
+ */
+static inline int ticker_symbol(const char *ticker, int len,
+                                const char *limit, ticker_slot_t *slots) {
+    if (len > 8 || limit - ticker < 8) {
+        // a long ticker, or one at the very end of the buffer
+        return intern_symbol_n(ticker, len);
+    }
+    uint64_t key = load_word(ticker) & (~0ULL >> (64 - 8 * len));
+    ticker_slot_t *slot = 
+        &slots[(key * 0x9e3779b97f4a7c15ULL) >> (64 - TICKER_SLOT_BITS)];
+    if (slot->len != len || slot->key != key) {
+        slot->symbol = intern_symbol_n(ticker, len);
+        slot->len = len;
+        slot->key = key;
+    }
+    return slot->symbol;
+}
+
+/*
+ * fields_from_commas: reads an order whose comma offsets are known. Only
+ *   handles well-formed lines; anything unusual is left to parse_order.
+ *   The checks are done together and the fields read with word-at-a-time
+ *   arithmetic, so a well-formed line costs few branches.
+ *
+ * line: first character of the line
+ * end: one past the last character (the newline or end of buffer)
+ * limit: end of the buffer
+ * commas: offsets of the line's six commas, relative to line
+ * slots: in/out, the batch's ticker slots
+ * msg: out parameter for the order
+ *
+ * Returns: true if the line was read, false if parse_order must decide
+ */
+static inline bool fields_from_commas(const char *line, const char *end,
+                                      const char *limit,
+                                      const uint32_t *commas,
+                                      ticker_slot_t *slots,
+                                      order_msg_t *msg) {
+    long long shares, price, oref;
+    if (end > line && end[-1] == '\r') {
+        end--;
+    }
+    char type = line[commas[1] + 1];
+    char book = line[commas[2] + 1];
+    bool ok = (commas[0] == 1) & (commas[1] >= 3) &
+              (commas[2] == commas[1] + 2) & (commas[3] == commas[2] + 2) &
+              ((type == 'A') | (type == 'C')) & 
+              ((book == 'B') | (book == 'S'));
+    if (!ok) {
+        return false;
+    }
+    int shares_len = commas[4] - commas[3] - 1;
+    int price_len = commas[5] - commas[4] - 1;
+    int oref_len = (int) (end - line) - commas[5] - 1;
+    if (!digits_value(line + commas[3] + 1, shares_len, limit, &shares) ||
+        !digits_value(line + commas[4] + 1, price_len, limit, &price) ||
+        !digits_value(line + commas[5] + 1, oref_len, limit, &oref) ||
+        shares == 0 || shares > INT_MAX) {
+        return false;
+    }
+
+    msg->venue = line[0];
+    msg->symbol = ticker_symbol(line + 2, commas[1] - 2, limit, slots);
+    msg->type = type;
+    msg->book = book;
+    msg->shares = (int) shares;
+    msg->price = price;
+    msg->oref = oref;
+    return true;
+}
+
+/*
+ * line_commas: finds the commas of a line from the comma mask
+ *
+ * mask: the comma mask of the window the line is in
+ * start: offset of the line in the window
+ * len: length of the line, at most BLOCK
+ * commas: out parameter, offsets of the commas, relative to the line
+ *
+ * Returns: true if the line has exactly NUM_COMMAS commas
+ */
+static inline bool line_commas(const uint64_t *mask, uint32_t start,
+                               int len, uint32_t *commas) {
+    int b = start / BLOCK;
+    int off = start % BLOCK;
+    uint64_t bits = mask[b] >> off;
+    if (off != 0) {
+        bits |= mask[b + 1] << (BLOCK - off);
+    }
+    if (len < BLOCK) {
+        bits &= ((uint64_t) 1 << len) - 1;
+    }
+    for (int k = 0; k < NUM_COMMAS; k++) {
+        if (bits == 0) {
+            return false;
+        }
+        commas[k] = __builtin_ctzll(bits);
+        bits &= bits - 1;
+    }
+    return bits == 0;
+}
+
+/*
+ * parse_line: parses one line, through the comma mask when the line is
+ *   short and has exactly six commas and parse_order otherwise
+ *
+ * base: start of the window
+ * start: offset of the line in the window
+ * end: offset of the end of the line (its newline) in the window
+ * limit: end of the buffer
+ * mask: the window's comma mask
+ * slots: in/out, the batch's ticker slots
+ * msg: out parameter for the order
+ *
+ * Returns: the parse status of the line
+ */
+static inline enum parse_status parse_line(const char *base, uint32_t start,
+                                           uint32_t end, const char *limit,
+                                           const uint64_t *mask,
+                                           ticker_slot_t *slots,
+                                           order_msg_t *msg) {
+    uint32_t commas[NUM_COMMAS];
+    if (end - start <= BLOCK && 
+        line_commas(mask, start, end - start, commas) &&
+        fields_from_commas(base + start, base + end, limit, commas, slots,
+                           msg)) {
+        return PARSE_OK;
+    }
+    return parse_order(base + start, base + end, msg);
+}
+
+/*
+ * parse_order_batch: parse the complete lines at the start of a buffer.
+ *   Every line, including empty and malformed ones, produces one entry
+ *   in msgs and statuses, so entry i always belongs to the i-th line.
+ *
+ * buf: the order lines
+ * len: the number of bytes in buf
+ * final: true if buf runs to the end of the input, in which case a last
+ *   line with no newline is parsed too. Otherwise it is left for the
+ *   next call.
+ * msgs: out parameter, parsed orders (valid where statuses[i] == PARSE_OK)
+ * statuses: out parameter, parse status of each line
+ * max_msgs: the number of entries msgs and statuses have room for
+ * num_msgs: out parameter, the number of lines parsed
+ *
+ * Returns: the number of bytes of buf used. Parsing resumes from there.
+ */
+size_t parse_order_batch(const char *buf, size_t len, bool final,
+                         order_msg_t *msgs, enum parse_status *statuses,
+                         int max_msgs, int *num_msgs) {
+    // one spare word, so a line's commas can always be read from two
+    uint64_t commas[NUM_BLOCKS + 1];
+    uint64_t newlines[NUM_BLOCKS + 1];
+    ticker_slot_t slots[TICKER_SLOTS] = {{0}};
+    const char *limit = buf + len;
+    size_t pos = 0;
+    int n = 0;
+
+    if (scan == NULL) {
+        set_batch_isa(best_batch_isa());
+    }
+    while (n < max_msgs && pos < len) {
+        int window = len - pos < WINDOW ? (int) (len - pos) : WINDOW;
+        int num_blocks = (window + BLOCK - 1) / BLOCK;
+        const char *base = buf + pos;
+        scan(base, window, commas, newlines);
+        commas[num_blocks] = 0;
+
+        // walk the newlines, finishing a line at each one
+        uint32_t line_start = 0;
+        for (int b = 0; b < num_blocks && n < max_msgs; b++) {
+            uint64_t bits = newlines[b];
+            while (bits != 0 && n < max_msgs) {
+                uint32_t nl = b * BLOCK + __builtin_ctzll(bits);
+                bits &= bits - 1;
+                statuses[n] = parse_line(base, line_start, nl, limit, 
+                                         commas, slots, &msgs[n]);
+                n++;
+                line_start = nl + 1;
+            }
+        }
+
+        if (line_start > 0) {
+            pos += line_start;
+        } else if (pos + window < len) {
+            // a line longer than the window: find its end the slow way
+            const char *nl = memchr(base, '\n', len - pos);
+            const char *end = nl != NULL ? nl : buf + len;
+            if (nl == NULL && !final) {
+                break;
+            }
+            statuses[n] = parse_order(base, end, &msgs[n]);
+            n++;
+            pos = nl != NULL ? (size_t) (nl - buf) + 1 : len;
+        } else {
+            // only a partial line is left
+            if (final) {
+                statuses[n] = parse_line(base, 0, window, limit, commas,
+                                         slots, &msgs[n]);
+                n++;
+                pos = len;
+            }
+            break;
+        }
+    }
+    *num_msgs = n;
+    return pos;
+}
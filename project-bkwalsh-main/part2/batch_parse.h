@@ -0,0 +1,65 @@
+/*
+ * CS 152, Spring 2022
+ * Bulk Order Parsing Interface.
+ *
+ * Parses a large buffer of order lines (the format read by
+ * mk_order_from_line, one order per line) into an array of order_msg_t
+ * in one pass. The buffer is first scanned for commas and newlines with
+ * SIMD compares (AVX2 or SSE2 when the CPU has them, picked at run time,
+ * a word at a time in plain C otherwise), which leaves one bit per byte.
+ * Each line's commas are then taken from those bits and the fields read
+ * from their positions 8 bytes at a time. Results match parse_order line
+ * for line, including the status reported for malformed lines.
+ */
+
+#ifndef BATCH_PARSE_H
+#define BATCH_PARSE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Ways the separator scan can run */
+enum batch_isa {BATCH_SCALAR, BATCH_SSE2, BATCH_AVX2};
+
+/*
+ * parse_order_batch: parse the complete lines at the start of a buffer.
+ *   Every line, including empty and malformed ones, produces one entry
+ *   in msgs and statuses, so entry i always belongs to the i-th line.
+ *
+ * buf: the order lines
+ * len: the number of bytes in buf
+ * final: true if buf runs to the end of the input, in which case a last
+ *   line with no newline is parsed too. Otherwise it is left for the
+ *   next call.
+ * msgs: out parameter, parsed orders (valid where statuses[i] == PARSE_OK)
+ * statuses: out parameter, parse status of each line
+ * max_msgs: the number of entries msgs and statuses have room for
+ * num_msgs: out parameter, the number of lines parsed
+ *
+ * Returns: the number of bytes of buf used. Parsing resumes from there.
+ */
+size_t parse_order_batch(const char *buf, size_t len, bool final,
+                         order_msg_t *msgs, enum parse_status *statuses,
+                         int max_msgs, int *num_msgs);
+
+/*
+ * best_batch_isa: the fastest separator scan this CPU supports
+ */
+enum batch_isa best_batch_isa();
+
+/*
+ * set_batch_isa: pick the separator scan parse_order_batch uses. By
+ *   default it uses best_batch_isa().
+ *
+ * isa: the scan to use; must be supported by this CPU
+ */
+void set_batch_isa(enum batch_isa isa);
+
+/*
+ * batch_isa_str: the name of a separator scan
+ *
+ * Returns: a constant string
+ */
+const char *batch_isa_str(enum batch_isa isa);
+
+#endif
@@ -0,0 +1,769 @@
+/*
+ * CS 152, Spring 2022
+ * Benchmarks
+ *
+ * Run make bench to compile and ./bench <benchmark> [args] to run one
+ * of the benchmarks below. Results are written to stderr as CSV:
+ *
+ *   ./bench book 10000000 heap
+ *   ./bench cancel 10000000
+ *   ./bench parse 100000000 tests/test9_orders.csv
+ *   ./bench batch 1024 tests/test9_orders.csv
+ *   ./bench submit 10000000
+ *   ./bench shard 10000000 1000 8
+ *   ./bench write 10000000
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "order.h"
+#include "book.h"
+#include "action_report.h"
+#include "action_sink.h"
+#include "action_writer.h"
+#include "exchange.h"
+#include "latency.h"
+#include "market.h"
+#include "shard.h"
+#include "batch_parse.h"
+#include "symbols.h"
+#include "util.h"
+
+#define BOOK_OPS 1000000
+#define BOOK_MIN_DEPTH 10
+#define BOOK_MAX_DEPTH 10000000
+#define BOOK_MAX_BATCH 1000
+#define BOOK_CYCLE 1024
+#define CANCEL_OPS 1000000
+#define CANCEL_MIN_DEPTH 1000
+#define CANCEL_MAX_DEPTH 10000000
+#define NUM_PRICES 1000
+#define BASE_PRICE 500000
+#define RESTING_SHARES 1000000000
+#define PARSE_LINES 100000000
+#define PARSE_FILE "tests/test9_orders.csv"
+#define MAX_LINE_LEN 1000
+#define BATCH_MB 1024
+#define BATCH_MSGS 4096
+#define SUBMIT_ORDERS 10000000
+#define SUBMIT_SPREAD 50
+#define SUBMIT_CANCEL_PCT 30
+#define WRITE_ACTIONS 10000000
+#define SHARD_TICKERS 1000
+#define SHARD_MAX_THREADS 8
+
+/* state for next_rand, fixed so every run sees the same sequence */
+static unsigned long long rand_state = 0x2545F4914F6CDD1DULL;
+
+/*
+ * next_rand: xorshift64 generator, so runs are repeatable and not
+ *  limited by RAND_MAX
+ */
+unsigned long long next_rand() {
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 7;
+    rand_state ^= rand_state << 17;
+    return rand_state;
+}
+
+/*
+ * now_ns: reads the monotonic clock
+ *
+ * Returns: time in nanoseconds
+ */
+double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * rss_mb: reads how much of the process is resident in memory
+ *
+ * Returns: resident set size in megabytes, 0 if it cannot be read
+ */
+double rss_mb() {
+    long pages = 0;
+    long resident = 0;
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (fp == NULL) {
+        return 0;
+    }
+    if (fscanf(fp, "%ld %ld", &pages, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(fp);
+    return (double) resident * sysconf(_SC_PAGESIZE) / (1 << 20);
+}
+
+/*
+ * clock_cost_ns: measures what one now_ns call costs, so batches too
+ *  small to hide it can take it out
+ *
+ * Returns: time in nanoseconds
+ */
+double clock_cost_ns() {
+    int calls = 100000;
+    double start = now_ns();
+    for (int i = 0; i < calls; i++) {
+        now_ns();
+    }
+    return (now_ns() - start) / calls;
+}
+
+/*
+ * report_op: prints one line of bench_book's output
+ */
+void report_op(char *op, long depth, long ops, double elapsed) {
+    double ns = elapsed / ops;
+    fprintf(stderr, "%s,%ld,%ld,%.1f,%.0f,%.1f\n", op, depth, ops, ns,
+            ns > 0 ? 1e9 / ns : 0, rss_mb());
+}
+
+/*
+ * bench_book: times each book operation, and process_order on a whole
+ *  exchange, against sell books of 10, 100, ... resting orders, for
+ *  scaling curves across book representations
+ *
+ * Orders rest on up to NUM_PRICES price levels. insert and rm_val are
+ * timed in batches of up to BOOK_MAX_BATCH orders, never more than a
+ * tenth of the depth, so the depth holds; the cost of reading the clock
+ * is taken out of each batch. process_order cycles through an add that
+ * rests, its cancel and a one share buy that executes against the best
+ * sell, so every order is a different path.
+ *
+ * max_depth: the deepest book to measure
+ * book_ops: the book representation
+ */
+void bench_book(long max_depth, const book_ops_t *book_ops) {
+    double clock_cost = clock_cost_ns();
+    fprintf(stderr, "op,depth,ops,ns_per_op,ops_per_sec,rss_mb\n");
+    for (long depth = BOOK_MIN_DEPTH; depth <= max_depth; depth *= 10) {
+        long levels = depth < NUM_PRICES ? depth : NUM_PRICES;
+        book_t *book = mk_book(book_ops, SELL_BOOK);
+        for (long i = 0; i < depth; i++) {
+            long long price = BASE_PRICE + next_rand() % levels;
+            insert(book, mk_order('I', "BENCH", 'A', 'S', RESTING_SHARES,
+                                  price, i, i));
+        }
+        int time = depth;
+
+        long batch = depth / 10;
+        if (batch < 1) {
+            batch = 1;
+        } else if (batch > BOOK_MAX_BATCH) {
+            batch = BOOK_MAX_BATCH;
+        }
+        order_t **extra = (order_t **) ck_malloc(sizeof(order_t *) * batch,
+                                                 "bench_book");
+        for (long j = 0; j < batch; j++) {
+            long long price = BASE_PRICE + next_rand() % levels;
+            extra[j] = mk_order('I', "BENCH", 'A', 'S', RESTING_SHARES,
+                                price, depth + j, 0);
+        }
+        double insert_ns = 0;
+        double rm_ns = 0;
+        long ops = 0;
+        while (ops < BOOK_OPS) {
+            for (long j = 0; j < batch; j++) {
+                extra[j]->time = time++;
+            }
+            double start = now_ns();
+            for (long j = 0; j < batch; j++) {
+                insert(book, extra[j]);
+            }
+            double mid = now_ns();
+            for (long j = 0; j < batch; j++) {
+                rm_val(book, extra[j]);
+            }
+            double end = now_ns();
+            insert_ns += mid - start - clock_cost;
+            rm_ns += end - mid - clock_cost;
+            ops += batch;
+        }
+        report_op("insert", depth, ops, insert_ns);
+        report_op("rm_val", depth, ops, rm_ns);
+        for (long j = 0; j < batch; j++) {
+            free_order(extra[j]);
+        }
+        free(extra);
+
+        long long check = 0;
+        double start = now_ns();
+        for (long op = 0; op < BOOK_OPS; op++) {
+            check += best_order(book)->oref;
+        }
+        report_op("best_order", depth, BOOK_OPS, now_ns() - start);
+
+        order_t *cancel = mk_order('I', "BENCH", 'C', 'S', 1, 0, 0, 0);
+        start = now_ns();
+        for (long op = 0; op < BOOK_OPS; op++) {
+            order_t *out = NULL;
+            bool sv = false;
+            cancel->oref = next_rand() % depth;
+            cancel->shares = 1;
+            compute_cancel(book, cancel, &out, &sv);
+            check += out == cancel;
+        }
+        report_op("compute_cancel", depth, BOOK_OPS, now_ns() - start);
+
+        // one share at a time off the best order, which never runs out
+        order_t *buy = mk_order('I', "BENCH", 'A', 'B', 1, 0, 0, 0);
+        order_t *best = best_order(book);
+        start = now_ns();
+        for (long op = 0; op < BOOK_OPS; op++) {
+            bool pendshares = false;
+            bool rm_pend = false;
+            buy->shares = 1;
+            check += update_order_shares(best, buy, &pendshares, &rm_pend);
+        }
+        report_op("update_order_shares", depth, BOOK_OPS, now_ns() - start);
+        if (check == 42) {
+            // keeps the compiler from dropping the loops
+            fprintf(stderr, "\n");
+        }
+        free_order(buy);
+        free_order(cancel);
+        free_book_lst(book);
+
+        exchange_t *exchange = mk_exchange_book("BENCH", book_ops);
+        for (long i = 0; i < depth; i++) {
+            long long price = BASE_PRICE + next_rand() % levels;
+            free_action_report(process_order_fields(exchange, 'I', 'A', 'S',
+                                                    RESTING_SHARES, price, i,
+                                                    i));
+        }
+        char **lines = (char **) ck_malloc(sizeof(char *) * BOOK_CYCLE * 3,
+                                           "bench_book");
+        char line[MAX_LINE_LEN];
+        for (int j = 0; j < BOOK_CYCLE; j++) {
+            long long price = BASE_PRICE + NUM_PRICES + next_rand() % levels;
+            sprintf(line, "I,BENCH,A,S,100,%lld,%ld", price, depth + j);
+            lines[3 * j] = ck_strdup(line, "bench_book");
+            sprintf(line, "I,BENCH,C,S,100,%lld,%ld", price, depth + j);
+            lines[3 * j + 1] = ck_strdup(line, "bench_book");
+            sprintf(line, "I,BENCH,A,B,1,%d,%ld", BASE_PRICE + NUM_PRICES,
+                    depth + BOOK_CYCLE + j);
+            lines[3 * j + 2] = ck_strdup(line, "bench_book");
+        }
+        start = now_ns();
+        for (long op = 0; op < BOOK_OPS; op++) {
+            free_action_report(process_order(exchange,
+                                             lines[op % (BOOK_CYCLE * 3)],
+                                             time++));
+        }
+        report_op("process_order", depth, BOOK_OPS, now_ns() - start);
+        for (int j = 0; j < BOOK_CYCLE * 3; j++) {
+            free(lines[j]);
+        }
+        free(lines);
+        free_exchange(exchange);
+    }
+}
+
+/*
+ * bench_cancel: times cancels against sell books of growing depth. Each
+ *  depth is timed twice: partial cancels that leave the order resting,
+ *  and full cancels with the order booked again so the depth holds.
+ *
+ * max_depth: the deepest book to measure
+ */
+void bench_cancel(long max_depth) {
+    fprintf(stderr, "depth,partial_cancel_ns,full_cancel_rebook_ns\n");
+    for (long depth = CANCEL_MIN_DEPTH; depth <= max_depth; depth *= 10) {
+        book_t *book = bookmaker(SELL_BOOK);
+        for (long i = 0; i < depth; i++) {
+            long long price = BASE_PRICE + next_rand() % NUM_PRICES;
+            insert(book, mk_order('I', "BENCH", 'A', 'S', RESTING_SHARES,
+                                  price, i, i));
+        }
+        order_t *cancel = mk_order('I', "BENCH", 'C', 'S', 1, 0, 0, 0);
+        int time = depth;
+
+        double start = now_ns();
+        for (int op = 0; op < CANCEL_OPS; op++) {
+            order_t *out = NULL;
+            bool sv = false;
+            cancel->oref = next_rand() % depth;
+            cancel->shares = 1;
+            compute_cancel(book, cancel, &out, &sv);
+            assert(out == cancel);
+        }
+        double partial = (now_ns() - start) / CANCEL_OPS;
+
+        start = now_ns();
+        for (int op = 0; op < CANCEL_OPS; op++) {
+            order_t *out = NULL;
+            bool sv = false;
+            cancel->oref = next_rand() % depth;
+            cancel->shares = RESTING_SHARES;
+            compute_cancel(book, cancel, &out, &sv);
+            assert(out != NULL && out != cancel);
+            out->time = time++;
+            insert(book, out);
+        }
+        double full = (now_ns() - start) / CANCEL_OPS;
+
+        fprintf(stderr, "%ld,%.1f,%.1f\n", depth, partial, full);
+        free_order(cancel);
+        free_book_lst(book);
+    }
+}
+
+/*
+ * sscanf_parse: the sscanf based parsing mk_order_from_line did before
+ *  parse_order, kept as the baseline for bench_parse
+ *
+ * Returns: true if the line parsed
+ */
+bool sscanf_parse(char *line, order_msg_t *msg) {
+    char ticker[MAX_LINE_LEN];
+    int num_matched = sscanf(line, "%c,%[^,],%c,%c,%d,%lld,%lld",
+                             &msg->venue, ticker, &msg->type, &msg->book,
+                             &msg->shares, &msg->price, &msg->oref);
+    if (num_matched != 7) {
+        return false;
+    }
+    msg->symbol = intern_symbol(ticker);
+    return true;
+}
+
+/*
+ * read_lines: reads every line of a file into memory
+ *
+ * filename: the file
+ * num_lines: out parameter for the number of lines read
+ *
+ * Returns: array of lines (newlines removed)
+ */
+char **read_lines(char *filename, int *num_lines) {
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "bench: cannot open %s\n", filename);
+        exit(1);
+    }
+    int n = 0;
+    int slots = 1024;
+    char **lines = (char **) ck_malloc(sizeof(char *) * slots, "read_lines");
+    char buffer[MAX_LINE_LEN];
+    while (fgets(buffer, MAX_LINE_LEN, fp) != NULL) {
+        buffer[strcspn(buffer, "\n")] = '\0';
+        if (n == slots) {
+            slots *= 2;
+            lines = (char **) ck_realloc(lines, sizeof(char *) * slots, 
+                                         "read_lines");
+        }
+        lines[n++] = ck_strdup(buffer, "read_lines");
+    }
+    fclose(fp);
+    *num_lines = n;
+    return lines;
+}
+
+/*
+ * bench_parse: times sscanf against parse_order_line over the lines of
+ *  an order file, repeated until total lines have been parsed
+ *
+ * total: number of lines to parse with each parser
+ * filename: order file to take lines from
+ */
+void bench_parse(long total, char *filename) {
+    int num_lines;
+    char **lines = read_lines(filename, &num_lines);
+    if (num_lines == 0) {
+        fprintf(stderr, "bench: %s is empty\n", filename);
+        exit(1);
+    }
+    long bytes = 0;
+    for (long i = 0; i < total; i++) {
+        bytes += strlen(lines[i % num_lines]) + 1;
+    }
+
+    fprintf(stderr, "parser,lines,ns_per_line,mb_per_sec\n");
+    for (int use_sscanf = 1; use_sscanf >= 0; use_sscanf--) {
+        order_msg_t msg;
+        long long check = 0;
+        double start = now_ns();
+        for (long i = 0; i < total; i++) {
+            char *line = lines[i % num_lines];
+            bool ok;
+            if (use_sscanf) {
+                ok = sscanf_parse(line, &msg);
+            } else {
+                ok = parse_order_line(line, &msg) == PARSE_OK;
+            }
+            assert(ok);
+            check += msg.oref;
+        }
+        double elapsed = now_ns() - start;
+        fprintf(stderr, "%s,%ld,%.1f,%.1f\n", 
+                use_sscanf ? "sscanf" : "parse_order_line", total,
+                elapsed / total, bytes / (elapsed / 1e9) / 1e6);
+        if (check == 42) {
+            // keeps the compiler from dropping the loop
+            fprintf(stderr, "\n");
+        }
+    }
+
+    for (int i = 0; i < num_lines; i++) {
+        free(lines[i]);
+    }
+    free(lines);
+}
+
+/*
+ * bench_batch: times parse_order_batch with each separator scan the CPU
+ *  supports, over a buffer made by repeating an order file
+ *
+ * mb: size of the buffer in megabytes
+ * filename: order file to repeat
+ */
+void bench_batch(long mb, char *filename) {
+    int num_lines;
+    char **lines = read_lines(filename, &num_lines);
+    if (num_lines == 0) {
+        fprintf(stderr, "bench: %s is empty\n", filename);
+        exit(1);
+    }
+    size_t size = (size_t) mb << 20;
+    char *buf = (char *) ck_malloc(size + MAX_LINE_LEN, "bench_batch");
+    size_t len = 0;
+    long total = 0;
+    while (len < size) {
+        char *line = lines[total % num_lines];
+        size_t line_len = strlen(line);
+        memcpy(buf + len, line, line_len);
+        buf[len + line_len] = '\n';
+        len += line_len + 1;
+        total++;
+    }
+
+    order_msg_t *msgs = (order_msg_t *) ck_malloc(sizeof(order_msg_t) * 
+                                                  BATCH_MSGS, "bench_batch");
+    enum parse_status *statuses = (enum parse_status *) 
+        ck_malloc(sizeof(enum parse_status) * BATCH_MSGS, "bench_batch");
+    fprintf(stderr, "scan,lines,ns_per_line,gb_per_sec\n");
+    for (int isa = BATCH_SCALAR; isa <= best_batch_isa(); isa++) {
+        set_batch_isa(isa);
+        long parsed = 0;
+        size_t pos = 0;
+        double start = now_ns();
+        while (pos < len) {
+            int n;
+            pos += parse_order_batch(buf + pos, len - pos, true, msgs, 
+                                     statuses, BATCH_MSGS, &n);
+            parsed += n;
+        }
+        double elapsed = now_ns() - start;
+        assert(parsed == total);
+        fprintf(stderr, "%s,%ld,%.2f,%.2f\n", batch_isa_str(isa), total, 
+                elapsed / total, len / elapsed);
+    }
+
+    free(msgs);
+    free(statuses);
+    free(buf);
+    for (int i = 0; i < num_lines; i++) {
+        free(lines[i]);
+    }
+    free(lines);
+}
+
+/*
+ * count_action: action_fn for bench_submit that only counts actions
+ */
+void count_action(void *ctx, int time, enum action action, long long oref,
+                  long long price, int shares) {
+    (*(long *) ctx)++;
+}
+
+/*
+ * bench_submit: times process_order against process_order_fields on
+ *  the same stream of orders. The string path includes the sprintf that
+ *  code holding the fields would need to build the line. A third pass
+ *  sends the fields to an exchange with a sink, so no report is made.
+ *
+ * total: number of orders to send down each path
+ */
+void bench_submit(long total) {
+    char *types = (char *) ck_malloc(total, "bench_submit");
+    char *books = (char *) ck_malloc(total, "bench_submit");
+    int *shares = (int *) ck_malloc(sizeof(int) * total, "bench_submit");
+    long long *prices = (long long *) ck_malloc(sizeof(long long) * total,
+                                                "bench_submit");
+    long long *orefs = (long long *) ck_malloc(sizeof(long long) * total,
+                                               "bench_submit");
+    for (long i = 0; i < total; i++) {
+        books[i] = (next_rand() & 1) ? 'B' : 'S';
+        shares[i] = 1 + next_rand() % 500;
+        if (i > 0 && (long) (next_rand() % 100) < SUBMIT_CANCEL_PCT) {
+            types[i] = 'C';
+            prices[i] = 0;
+            orefs[i] = next_rand() % i;
+        } else {
+            // buys just below and sells just above, so some cross
+            long long offset = next_rand() % SUBMIT_SPREAD;
+            types[i] = 'A';
+            prices[i] = books[i] == 'B' ? BASE_PRICE - offset + 5
+                                        : BASE_PRICE + offset - 5;
+            orefs[i] = i;
+        }
+    }
+
+    fprintf(stderr, "path,orders,ns_per_order\n");
+    for (int use_fields = 0; use_fields <= 1; use_fields++) {
+        exchange_t *exchange = mk_exchange("BENCH");
+        char ord_str[MAX_LINE_LEN];
+        double start = now_ns();
+        for (long i = 0; i < total; i++) {
+            action_report_t *ar;
+            if (use_fields) {
+                ar = process_order_fields(exchange, 'I', types[i], books[i],
+                                          shares[i], prices[i], orefs[i], i);
+            } else {
+                sprintf(ord_str, "I,BENCH,%c,%c,%d,%lld,%lld", types[i],
+                        books[i], shares[i], prices[i], orefs[i]);
+                ar = process_order(exchange, ord_str, i);
+            }
+            free_action_report(ar);
+        }
+        double elapsed = now_ns() - start;
+        fprintf(stderr, "%s,%ld,%.1f\n", 
+                use_fields ? "process_order_fields" : "sprintf+process_order",
+                total, elapsed / total);
+        free_exchange(exchange);
+    }
+
+    // the sink path again with latency tracking, timing every order and
+    // then the default sample, to show what it costs
+    latency_stats_t *every = mk_latency_stats(1);
+    latency_stats_t *sampled = mk_latency_stats(LATENCY_SAMPLE_EVERY);
+    latency_stats_t *runs[] = {NULL, every, sampled};
+    for (int run = 0; run < 3; run++) {
+        long num_actions = 0;
+        action_sink_t sink = {count_action, &num_actions};
+        exchange_t *exchange = mk_exchange_sink("BENCH", &sink);
+        exchange_track_latency(exchange, runs[run]);
+        order_msg_t msg;
+        msg.venue = 'I';
+        msg.symbol = find_symbol("BENCH");
+        double start = now_ns();
+        for (long i = 0; i < total; i++) {
+            msg.type = types[i];
+            msg.book = books[i];
+            msg.shares = shares[i];
+            msg.price = prices[i];
+            msg.oref = orefs[i];
+            send_order_msg(exchange, &msg, i);
+        }
+        double elapsed = now_ns() - start;
+        if (run == 0) {
+            fprintf(stderr, "send_order_msg,%ld,%.1f\n", total,
+                    elapsed / total);
+        } else {
+            fprintf(stderr, "send_order_msg+latency_1/%d,%ld,%.1f\n",
+                    latency_sample_every(runs[run]), total, elapsed / total);
+        }
+        free_exchange(exchange);
+    }
+    fprintf(stderr, "\n");
+    print_latency_stats(every, stderr);
+    free_latency_stats(every);
+    free_latency_stats(sampled);
+
+    free(types);
+    free(books);
+    free(shares);
+    free(prices);
+    free(orefs);
+}
+
+/*
+ * bench_shard: times a multi-ticker replay through a market on this
+ *  thread, then through shard sets with 1, 2, 4, ... workers
+ *
+ * total: number of orders
+ * num_tickers: number of tickers the orders are spread over
+ * max_threads: most workers to try
+ */
+void bench_shard(long total, int num_tickers, int max_threads) {
+    order_msg_t *msgs = (order_msg_t *) ck_malloc(sizeof(order_msg_t) * 
+                                                  total, "bench_shard");
+    char ticker[16];
+    int first = num_symbols();
+    for (int i = 0; i < num_tickers; i++) {
+        sprintf(ticker, "T%d", i);
+        intern_symbol(ticker);
+    }
+    for (long i = 0; i < total; i++) {
+        order_msg_t *msg = &msgs[i];
+        msg->venue = 'I';
+        msg->symbol = first + next_rand() % num_tickers;
+        msg->book = (next_rand() & 1) ? 'B' : 'S';
+        msg->shares = 1 + next_rand() % 500;
+        if (i > 0 && (long) (next_rand() % 100) < SUBMIT_CANCEL_PCT) {
+            msg->type = 'C';
+            msg->price = 0;
+            msg->oref = next_rand() % i;
+        } else {
+            long long offset = next_rand() % SUBMIT_SPREAD;
+            msg->type = 'A';
+            msg->price = msg->book == 'B' ? BASE_PRICE - offset + 5
+                                          : BASE_PRICE + offset - 5;
+            msg->oref = i;
+        }
+    }
+
+    fprintf(stderr, "engine,threads,orders,ns_per_order,orders_per_sec\n");
+    market_t *market = mk_market();
+    double start = now_ns();
+    for (long i = 0; i < total; i++) {
+        free_action_report(market_process_msg(market, &msgs[i], i));
+    }
+    double elapsed = now_ns() - start;
+    fprintf(stderr, "market,1,%ld,%.1f,%.0f\n", total, elapsed / total, 
+            total / (elapsed / 1e9));
+    free_market(market);
+
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        shard_set_t *set = mk_shard_set(threads, true);
+        start = now_ns();
+        for (long i = 0; i < total; i++) {
+            shard_submit_msg(set, &msgs[i], i);
+        }
+        shard_finish(set);
+        elapsed = now_ns() - start;
+        fprintf(stderr, "shard,%d,%ld,%.1f,%.0f\n", threads, total, 
+                elapsed / total, total / (elapsed / 1e9));
+        free_shard_set(set);
+    }
+    free(msgs);
+}
+
+/*
+ * bench_write: times write_action_report_to_file against an action
+ *  writer, writing one-action reports to /dev/null
+ *
+ * total: number of actions to write each way
+ */
+void bench_write(long total) {
+    FILE *fp = fopen("/dev/null", "w");
+    assert(fp != NULL);
+    action_report_t *ar = mk_action_report("BENCH");
+    fprintf(stderr, "writer,actions,ns_per_action\n");
+    for (int use_writer = 0; use_writer <= 1; use_writer++) {
+        action_writer_t *writer = mk_action_writer(fileno(fp));
+        double start = now_ns();
+        for (long i = 0; i < total; i++) {
+            reset_action_report(ar, "BENCH");
+            add_action(ar, i % (CANCEL_SELL + 1), 1000000 + i, 
+                       BASE_PRICE + i % NUM_PRICES, 1 + i % 500);
+            if (use_writer) {
+                writer_add_report(writer, ar, i);
+            } else {
+                write_action_report_to_file(ar, fp, i);
+            }
+        }
+        free_action_writer(writer);
+        fflush(fp);
+        double elapsed = now_ns() - start;
+        fprintf(stderr, "%s,%ld,%.1f\n", 
+                use_writer ? "action_writer" : "write_action_report_to_file",
+                total, elapsed / total);
+    }
+    free_action_report(ar);
+    fclose(fp);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: bench book [max depth] [ladder|heap|list]\n");
+        fprintf(stderr, "       bench cancel [max depth]\n");
+        fprintf(stderr, "       bench parse [lines] [order file]\n");
+        fprintf(stderr, "       bench batch [megabytes] [order file]\n");
+        fprintf(stderr, "       bench submit [orders]\n");
+        fprintf(stderr, "       bench shard [orders] [tickers] "
+                "[max threads]\n");
+        fprintf(stderr, "       bench write [actions]\n");
+        exit(1);
+    }
+    if (strcmp(argv[1], "book") == 0) {
+        long max_depth = BOOK_MAX_DEPTH;
+        const book_ops_t *ops = default_book_ops();
+        if (argc > 2) {
+            max_depth = atol(argv[2]);
+        }
+        if (argc > 3) {
+            ops = find_book_ops(argv[3]);
+            if (ops == NULL) {
+                fprintf(stderr, "bench: unknown book %s\n", argv[3]);
+                exit(1);
+            }
+        }
+        bench_book(max_depth, ops);
+    } else if (strcmp(argv[1], "cancel") == 0) {
+        long max_depth = CANCEL_MAX_DEPTH;
+        if (argc > 2) {
+            max_depth = atol(argv[2]);
+        }
+        bench_cancel(max_depth);
+    } else if (strcmp(argv[1], "parse") == 0) {
+        long total = PARSE_LINES;
+        char *filename = PARSE_FILE;
+        if (argc > 2) {
+            total = atol(argv[2]);
+        }
+        if (argc > 3) {
+            filename = argv[3];
+        }
+        bench_parse(total, filename);
+    } else if (strcmp(argv[1], "batch") == 0) {
+        long mb = BATCH_MB;
+        char *filename = PARSE_FILE;
+        if (argc > 2) {
+            mb = atol(argv[2]);
+        }
+        if (argc > 3) {
+            filename = argv[3];
+        }
+        bench_batch(mb, filename);
+    } else if (strcmp(argv[1], "submit") == 0) {
+        long total = SUBMIT_ORDERS;
+        if (argc > 2) {
+            total = atol(argv[2]);
+        }
+        bench_submit(total);
+    } else if (strcmp(argv[1], "shard") == 0) {
+        long total = SUBMIT_ORDERS;
+        int num_tickers = SHARD_TICKERS;
+        int max_threads = SHARD_MAX_THREADS;
+        if (argc > 2) {
+            total = atol(argv[2]);
+        }
+        if (argc > 3) {
+            num_tickers = atoi(argv[3]);
+        }
+        if (argc > 4) {
+            max_threads = atoi(argv[4]);
+        }
+        bench_shard(total, num_tickers, max_threads);
+    } else if (strcmp(argv[1], "write") == 0) {
+        long total = WRITE_ACTIONS;
+        if (argc > 2) {
+            total = atol(argv[2]);
+        }
+        bench_write(total);
+    } else {
+        fprintf(stderr, "bench: unknown benchmark %s\n", argv[1]);
+        exit(1);
+    }
+    return 0;
+}
@@ -1,6 +1,8 @@
 /*
  * CS 152, Spring 2022
- * Book Data Structure Implementation
+ * Book Data Structure Implementation: logic shared by every book
+ * representation (book_ladder.c, book_heap.c, book_list.c), and the 
+ * public book functions, which go to the book's representation
  * 
  * You will modify this file.
  */
@@ -9,355 +11,280 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "order.h"
 #include "book.h"
+#include "book_backend.h"
 #include "util.h"
  
+/* The Makefile passes -DDEFAULT_BOOK=book_<BOOK>_ops */
+#ifndef DEFAULT_BOOK
+#define DEFAULT_BOOK book_ladder_ops
+#endif
 
-struct book {
-    enum book_type type; 
-    int num_slots;
-    int num_occupied;
-    order_t **array;
+static const book_ops_t *all_ops[] = {
+    &book_ladder_ops, &book_heap_ops, &book_list_ops
 };
 
-#define INIT_SLOTS 10
-#define SLOTS_MULTIPLIER 2
+static const book_ops_t *default_ops = &DEFAULT_BOOK;
 
 /* 
- * order_cmp: Compares two orders. If b1 should come before b2, returns true;
+ * find_book_ops: Looks up a book representation by name
  *
- * b1: An order, b2: a different order
- * 
- * Uses is_buy_order and is_sell_order to measure what
- * order_cmp should be based
- * on (either less than or greater than, based on buyer seller hierarchy) 
- * if price is equal returns time as tiebreaker (previous orders go first
- *  for both cases)
- * 
- * Note: only measuring b1 for being buyer/ seller order because the way
- * that I intend to apply order_cmp is in cases where orders to order_list_t
- * are already orginized. This is why there is not any error catching to 
- * be certain that both b1 and b2 are of the same order type 
- * 
- * Returns: boolean, true if b1 should come before b2
+ * name: "ladder", "heap" or "list"
+ *
+ * Returns: the representation, or NULL if there is none by that name
  */
-bool order_cmp(order_t *b1, order_t *b2) { 
-    assert(b1 != NULL);
-    assert(b2 != NULL);
-    if (b1->price != b2->price){
-       if (is_buy_order(b1)) {
-            return b1->price > b2->price;
-        } else if (is_sell_order(b1)){
-            return b1->price < b2->price; 
-        } 
+const book_ops_t *find_book_ops(const char *name) {
+    for (size_t i = 0; i < sizeof(all_ops) / sizeof(all_ops[0]); i++) {
+        if (strcmp(all_ops[i]->name, name) == 0) {
+            return all_ops[i];
+        }
     }
-    return b1->time < b2->time;
+    return NULL;
 }
 
 /* 
- * bookmaker: Creates a new book with an empty order_list 
+ * book_ops_at: Lists the book representations
  *
- * val: enum book_type indicating what type the book should have
- * 
- * Returns: Initalized book
+ * i: 0, 1, 2, ...
+ *
+ * Returns: the i-th representation, or NULL once i is past the last one
  */
-book_t *bookmaker(enum book_type val){
-    book_t *out = (book_t*)malloc(sizeof(book_t));
-    if (out == NULL) {
-        fprintf(stderr, "book_t: Unable to allocate\n");
-        exit(1);
-    }
-    out->type = val;
-    out->num_slots = 5;
-    out->num_occupied = 0;
-    out->array= (order_t**)malloc(sizeof(order_t*) * INIT_SLOTS);
-    if (out->array == NULL) {
-        fprintf(stderr, "book_t: Unable to allocate\n");
-        exit(1);
+const book_ops_t *book_ops_at(int i) {
+    if (i < 0 || i >= (int) (sizeof(all_ops) / sizeof(all_ops[0]))) {
+        return NULL;
     }
-    return out;
+    return all_ops[i];
 }
 
-
 /* 
- * free_array: Frees an array of order_lists
+ * book_ops_name: The name of a book representation
  *
- * array: Array of orders
- * size: length of array
- * 
- * Returns: Nothing
+ * Returns: the name, as find_book_ops takes it
  */
-void free_array(order_t **array, int size){
-    for(int i=0;i<size;i++){
-        free_order(array[i]);
-    }
+const char *book_ops_name(const book_ops_t *ops) {
+    return ops->name;
 }
 
 /* 
- * free_book_lst: Frees all values in a book
+ * default_book_ops: The representation bookmaker uses
  *
- * value: book to be freed
- * 
- * Returns: Nothing
+ * Returns: the representation
  */
-void free_book_lst(book_t *value){
-    free_array(value->array, value->num_occupied);
-    free(value->array);
-    free (value);
+const book_ops_t *default_book_ops() {
+    return default_ops;
 }
 
-
 /* 
- * print_order_lst: Prints all values in an array order list
+ * set_default_book_ops: Changes the representation bookmaker uses, for
+ * books made from now on
  *
- * lst: list to be printed
+ * ops: the representation
  */
-void print_array(order_t *array[], int len) {
-    for(int i = 0;i < len;i++){
-        print_order(array[i]);
-    }
+void set_default_book_ops(const book_ops_t *ops) {
+    assert(ops != NULL);
+    default_ops = ops;
 }
 
-
 /* 
- * print_contents_of_book: Prints all the contents in a book list
+ * mk_book: Creates a new, empty book with a given representation
  *
- * book: book to be printed
+ * ops: the representation
+ * val: enum book_type indicating what type the book should have
+ * 
+ * Returns: Initalized book
  */
-void print_contents_of_book(book_t *book){
-    if (book->type == BUY_BOOK) {
-        printf("Buy book: \n");
-    } else {
-        printf("Sell book: \n");
-    }
-    print_array(book->array, book->num_occupied);
+book_t *mk_book(const book_ops_t *ops, enum book_type val) {
+    book_t *book = ops->make(val);
+    assert(book->ops == ops && book->type == val);
+    return book;
 }
 
-
-
 /* 
- * update_order_shares: Updates the amount of shares when a transaction is
- * being made. Returns an order to be reported to the action report
- * as well as modifying the shares on either pending list
+ * bookmaker: Creates a new book with an empty order_list, using the
+ * default representation
  *
- * Returns: Updated order
+ * val: enum book_type indicating what type the book should have
+ * 
+ * Returns: Initalized book
  */
-order_t *update_order_shares(order_t *pend_order, order_t *new_order,
-    bool *pendshares, bool *rm_pend){
-    if (pend_order->shares == new_order->shares){
-        *pendshares = false;
-        *rm_pend = true;
-        new_order = copy_order(pend_order); 
-        return new_order;
-    } else if (pend_order->shares > new_order->shares ){
-        *pendshares = false;
-        *rm_pend = false;
-        pend_order->shares = pend_order->shares - new_order->shares;
-        int hold= new_order->shares;
-        new_order = copy_order(pend_order); 
-        new_order->shares = hold; 
-        return new_order;
-    } else{
-        *pendshares = true;
-        *rm_pend = true;
-        new_order->shares = new_order->shares - pend_order->shares;
-        order_t *out_order = copy_order(pend_order); 
-        return out_order;
-    }
+book_t *bookmaker(enum book_type val) {
+    return mk_book(default_ops, val);
 }
 
-
 /* 
- * swap: swaps to orders
- * a, b= orders to be swapped
+ * book_ops_of: The representation a book was made with
  *
- * Returns: nothing
+ * Returns: the representation
  */
-void swap(order_t *a, order_t *b) {
-    order_t temp = *a;
-    *a = *b;
-    *b = temp;
+const book_ops_t *book_ops_of(book_t *book) {
+    return book->ops;
 }
 
 /* 
- * parent: returns parent index of a node for a BST. If parent DNE, returns -1
+ * free_book_lst: Frees all values in a book
  *
- * Returns: Int (parent index or -1)
+ * value: book to be freed
  */
-int parent(int val){
-    val=(val-1)/2;
-    if (val>=0){
-        return val;
-    } else{
-        return -1;
-    }
+void free_book_lst(book_t *value) {
+    value->ops->free(value);
 }
 
 /* 
- * left_child: returns left child index of a node for a BST
- *
- * Returns: Int, left child index
+ * print_one: for_each_order function for print_contents_of_book
  */
-int left_child(int val){
-    val=(val*2)+1;
-    return val;
+static void print_one(void *ctx, order_t *order) {
+    print_order(order);
 }
 
 /* 
- * right_child: returns right child index of a node for a BST
+ * print_contents_of_book: Prints all the contents in a book list, in the
+ * order for_each_order visits them
  *
- * Returns: Int, right child index
+ * book: book to be printed
  */
-int right_child(int val){
-    val=(val*2)+2;
-    return val;
+void print_contents_of_book(book_t *book) {
+    if (book->type == BUY_BOOK) {
+        printf("Buy book: \n");
+    } else {
+        printf("Sell book: \n");
+    }
+    for_each_order(book, print_one, NULL);
 }
 
-
 /* 
- * sift_up: swaps values from the bottom up. Adds a node to the 
- *  bottom and then swaps it into place
- * array: array of orders (in BST ordering)
- * index: order to be added
- * size: length of array
+ * for_each_order: Calls a function on every order resting in a book
  *
- * Returns: Nothing, modifies BST
+ * book: the book
+ * fn: the function, given ctx and the order. It must not change the book
+ * ctx: passed to fn
  */
-void sift_up(order_t *array[], int index, int size) {
-    int parent_index;
-    while(true){
-        if (index==0){
-            return;
-        }
-        parent_index=parent(index);
-        if (order_cmp(array[index],array[parent_index])){
-            swap(array[index], array[parent_index]);
-            index=parent_index;
-        } else{
-            return;
-        }
-    }
+void for_each_order(book_t *book, void (*fn)(void *ctx, order_t *order),
+                    void *ctx) {
+    book->ops->iterate(book, fn, ctx);
 }
 
-
 /* 
- * sift_down: swaps values from the top down to reorginze the order at given
- * index
- * array: array of orders (in BST ordering)
- * index: index of order to be reorginzed
- * size: length of array
- *
- * Returns: Nothing, modifies BST
+ * insert: Inserts a value into a book in the appropriate place
+ * 
+ * book: Book where the value is to be added to
+ * inc_order: incoming order to be added
  */
-void sift_down(order_t *array[],int size,int index){
-    while(true){
-        int min_index=index;
-        int left = left_child(index), right = right_child(index);
-        if(left < size) {
-            if(order_cmp(array[left], array[min_index])) min_index = left;
-        }
-        if(right < size) {
-            if(order_cmp(array[right], array[min_index])) min_index = right;
-        }
-        if(min_index != index){
-            swap(array[index], array[min_index]);
-            index=min_index;
-        } else{
-            return;
-        }
-    }
+void insert(book_t *book, order_t *inc_order) {
+    book->ops->insert(book, inc_order);
 }
 
 /* 
- * remove_min: Removes the last value of a BST by swapping it with the root
- * and calling sift down
- * array: array of orders (in BST ordering)
- * size: length of array
+ * best_order: Returns the "best order" for a book. If book is empty,
+ * returns NULL
+ * 
+ * book: Book where the order is to be drawn from
  *
- * Returns: Nothing, modifies BST
+ * Returns: Desired order if book is not empty, otherwise NULL
  */
-void remove_min(order_t *array[], int *size) {
-    order_t *last = array[*size - 1];
-    array[0] = last;
-    *size = *size - 1;
-    sift_down(array, *size, 0);
+order_t *best_order(book_t *book) {
+    return book->ops->best(book);
 }
 
-
 /* 
- * rm_val: Swaps the root val with desired removal index. Sets index to null
- * if only val is removed
+ * rm_val: Removes a resting order from the book. The order itself is not
+ * freed
  * 
  * book: Where the value is to be removed from
- * rm_index: index of the desired removal val
- *
- * Returns: Nothing, modifies BST, modifes book->num_occupied up to date
+ * order: the resting order to be removed
  */
-void rm_val(book_t *book, int rm_index){
-    order_t **array=book->array;
-    int size=book->num_occupied--;
-    swap(array[0],array[rm_index]);
-    remove_min(array, &size);
-    if (book->num_occupied==0){
-        book->array[0]=NULL;
-    } 
+void rm_val(book_t *book, order_t *order) {
+    book->ops->remove(book, order);
 }
 
 /* 
- * insert: Inserts a value into a book in the appropriate place. Modifes memory
- * as needed
+ * find_resting: Finds the resting order with the given oref
  * 
- * book: Book where the value is to be added to
- * inc_order: incoming order to be added
+ * book: Book to search
+ * oref: oref to look for
  *
- * Returns: Nothing, modifies BST, modifes book->num_occupied up to date, adds
- *  order and arranges memory. Uses sift_up for ordering
+ * Returns: the resting order, or NULL if there isn't one
  */
-void insert(book_t *book, order_t *inc_order) {
-    int nt = book->num_occupied;
-    int ns = book->num_slots;
-
-    if (nt == ns) {
-        int new_num_slots = (int) (ns * SLOTS_MULTIPLIER);
-        book->array = (order_t **) ck_realloc(book->array, 
-					      sizeof(order_t*) * new_num_slots, 
-					      "insert");
-        book->num_slots = new_num_slots;
-        ns = new_num_slots;
-    }    
-    assert(nt < ns);
-    book->array[nt]=inc_order;
-    book->num_occupied++;
-    sift_up(book->array, book->num_occupied-1, book->num_occupied);
+order_t *find_resting(book_t *book, long long oref) {
+    return book->ops->find(book, oref);
 }
-
+ 
 
 /* 
- * best_order: Returns the "best order" for a book. Will be the first order
- * Best order is first order in priority lists. If book is empty, returns NULL
- * 
- * book: Book where the order is to be drawn from
+ * order_cmp: Compares two orders. If b1 should come before b2, returns true;
  *
- * Returns: Desired order if book is not empty, otherwise NULL
+ * b1: An order, b2: a different order
+ * 
+ * Uses is_buy_order and is_sell_order to measure what
+ * order_cmp should be based
+ * on (either less than or greater than, based on buyer seller hierarchy) 
+ * if price is equal returns time as tiebreaker (previous orders go first
+ *  for both cases)
+ * 
+ * Note: only measuring b1 for being buyer/ seller order because the way
+ * that I intend to apply order_cmp is in cases where orders to order_list_t
+ * are already orginized. This is why there is not any error catching to 
+ * be certain that both b1 and b2 are of the same order type 
+ * 
+ * Returns: boolean, true if b1 should come before b2
  */
-order_t *best_order(book_t *book){
-    if (book->num_occupied==0){
-        return NULL;
+bool order_cmp(order_t *b1, order_t *b2) { 
+    assert(b1 != NULL);
+    assert(b2 != NULL);
+    if (b1->price != b2->price){
+       if (is_buy_order(b1)) {
+            return b1->price > b2->price;
+        } else if (is_sell_order(b1)){
+            return b1->price < b2->price; 
+        } 
     }
-    return book->array[0];
+    return b1->time < b2->time;
 }
 
+/* 
+ * update_order_shares: Updates the amount of shares when a transaction is
+ * being made, modifying the shares on either the pending or the new order.
+ * Nothing is allocated: the fill is reported from the pending order and
+ * the returned share count
+ *
+ * pend_order: the resting order being traded against
+ * new_order: the incoming order
+ * pendshares: set to true if the new order has shares left after the fill
+ * rm_pend: set to true if the pending order is used up and must be removed
+ *
+ * Returns: the number of shares traded
+ */
+int update_order_shares(order_t *pend_order, order_t *new_order,
+    bool *pendshares, bool *rm_pend){
+    if (pend_order->shares == new_order->shares){
+        *pendshares = false;
+        *rm_pend = true;
+        return pend_order->shares;
+    } else if (pend_order->shares > new_order->shares ){
+        *pendshares = false;
+        *rm_pend = false;
+        pend_order->shares = pend_order->shares - new_order->shares;
+        return new_order->shares;
+    } else{
+        *pendshares = true;
+        *rm_pend = true;
+        new_order->shares = new_order->shares - pend_order->shares;
+        return pend_order->shares;
+    }
+}
 
 
 /* 
  * compute_cancel: Removes a cancel order from a book if possible
- * Logic of doing compute_cancel in book.c is because doing the array work
+ * Logic of doing compute_cancel in book.c is because doing the ladder work
  * in exchange.c would enable exchange.c to see the length/ amount of orders
- * in the current heap if the cancel DNE. This felt like a violation of the 
+ * in the current book if the cancel DNE. This felt like a violation of the 
  * opaqueness of the book type. Compute cancel considers the logic of cancels
- * and removes orders appropriately
+ * and removes orders appropriately. The resting order is found through the
+ * book's oref index (find_resting), so a cancel does not depend on the 
+ * depth of the book
  * 
  * book: Book to query for a cancel order
  * order: Incoming cancel order
@@ -367,26 +294,17 @@ order_t *best_order(book_t *book){
  * Returns: None. Modifes the book if appropriate and sets out parameter
  */
 void compute_cancel(book_t *book, order_t *order, order_t **out, bool *sv){
-    int search_oref=order->oref;
-    for (int i=0; i<book->num_occupied; i++){ 
-        if (book->array[i]->oref==search_oref){
-            if(order->shares == book->array[i]->shares){
-                *out=book->array[i]; 
-                rm_val(book,i);
-                *sv=false;
-                return;
-            } else if (order->shares > book->array[i]->shares){
-                *out=book->array[i]; 
-                rm_val(book, i);
-                *sv=false;                
-                return;
-            } else{
-                *out=order;
-                book->array[i]->shares=book->array[i]->shares-order->shares;
-                *sv=true;                
-                return;
-            }
-        }
+    order_t *resting = find_resting(book, order->oref);
+    if (resting == NULL) {
+        return;
+    }
+    if (order->shares >= resting->shares) {
+        *out = resting;
+        rm_val(book, resting);
+        *sv = false;
+    } else {
+        *out = order;
+        resting->shares = resting->shares - order->shares;
+        *sv = true;
     }
-    return;
 }
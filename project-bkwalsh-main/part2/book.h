@@ -23,9 +23,103 @@ typedef struct book book_t;
 // go here.  Don't forget to include header
 // comments that describe the purpose of the
 // functions, the arguments, and the return value.
+//
+// Three representations implement these functions: book_ladder.c (price
+// levels with a FIFO queue each), book_heap.c (indexed binary heap) and
+// book_list.c (sorted linked list). All of them are linked in and each
+// book is made with one of them (mk_book). book.c holds the logic they
+// share and sends everything else to the book's representation.
+
+/* A book representation. Each one is a table of operations (see
+ * book_backend.h); these are the ones there are.
+ */
+typedef struct book_ops book_ops_t;
+
+extern const book_ops_t book_ladder_ops;
+extern const book_ops_t book_heap_ops;
+extern const book_ops_t book_list_ops;
+
+/* 
+ * find_book_ops: Looks up a book representation by name
+ *
+ * name: "ladder", "heap" or "list"
+ *
+ * Returns: the representation, or NULL if there is none by that name
+ */
+const book_ops_t *find_book_ops(const char *name);
 
 /* 
- * bookmaker: Creates a new book with an empty order_list 
+ * book_ops_at: Lists the book representations
+ *
+ * i: 0, 1, 2, ...
+ *
+ * Returns: the i-th representation, or NULL once i is past the last one
+ */
+const book_ops_t *book_ops_at(int i);
+
+/* 
+ * book_ops_name: The name of a book representation
+ *
+ * Returns: the name, as find_book_ops takes it
+ */
+const char *book_ops_name(const book_ops_t *ops);
+
+/* 
+ * default_book_ops: The representation bookmaker uses. It starts as the
+ * one the Makefile's BOOK variable names
+ *
+ * Returns: the representation
+ */
+const book_ops_t *default_book_ops();
+
+/* 
+ * set_default_book_ops: Changes the representation bookmaker uses, for
+ * books made from now on. Not thread safe: call it before starting any
+ * threads that make exchanges
+ *
+ * ops: the representation
+ */
+void set_default_book_ops(const book_ops_t *ops);
+
+/* 
+ * mk_book: Creates a new, empty book with a given representation
+ *
+ * ops: the representation
+ * val: enum book_type indicating what type the book should have
+ * 
+ * Returns: Initalized book
+ */
+book_t *mk_book(const book_ops_t *ops, enum book_type val);
+
+/* 
+ * book_ops_of: The representation a book was made with
+ *
+ * Returns: the representation
+ */
+const book_ops_t *book_ops_of(book_t *book);
+
+/* 
+ * for_each_order: Calls a function on every order resting in a book, in
+ * priority order for the ladder and list, and heap order for the heap
+ *
+ * book: the book
+ * fn: the function, given ctx and the order. It must not change the book
+ * ctx: passed to fn
+ */
+void for_each_order(book_t *book, void (*fn)(void *ctx, order_t *order),
+                    void *ctx);
+
+/* 
+ * order_cmp: Compares two orders. If b1 should come before b2, returns true;
+ * Better price wins, ties go to the earlier time
+ *
+ * Returns: boolean, true if b1 should come before b2
+ */
+bool order_cmp(order_t *b1, order_t *b2);
+
+/* 
+ * bookmaker: Creates a new book with an empty order_list, using the
+ * default representation
  *
  * val: enum book_type indicating what type the book should have
  * 
@@ -51,35 +145,38 @@ void print_contents_of_book(book_t *book);
 
 /* 
  * update_order_shares: Updates the amount of shares when a transaction is
- * being made. Returns an order to be reported to the action report
- * as well as modifying the shares on either pending list
+ * being made, modifying the shares on either the pending or the new order.
+ * Nothing is allocated: the fill is reported from the pending order and
+ * the returned share count
+ *
+ * pend_order: the resting order being traded against
+ * new_order: the incoming order
+ * pendshares: set to true if the new order has shares left after the fill
+ * rm_pend: set to true if the pending order is used up and must be removed
  *
- * Returns: Updated order
+ * Returns: the number of shares traded
  */
-order_t *update_order_shares(order_t *pend_order, order_t *new_order,
+int update_order_shares(order_t *pend_order, order_t *new_order,
     bool *pendshares, bool *rm_pend);
 
 /* 
- * rm_val: Swaps the root val with desired removal index. Sets index to null
- * if only val is removed
+ * rm_val: Removes a resting order from the book and from the book's oref
+ * index, so find_resting no longer finds it. The order itself is not
+ * freed
  * 
  * book: Where the value is to be removed from
- * rm_index: index of the desired removal val
- *
- * Returns: Nothing, modifies BST, modifes book->num_occupied up to date
+ * order: the resting order to be removed
  */
-void rm_val(book_t *book, int rm_index);
+void rm_val(book_t *book, order_t *order);
 
 
 /*
- * insert: Inserts a value into a book in the appropriate place. Modifes memory
- * as needed
+ * insert: Adds a resting order to the book behind every order it does not
+ * have priority over, and to the book's oref index. The book keeps the
+ * order until it is removed with rm_val
  * 
  * book: Book where the value is to be added to
  * inc_order: incoming order to be added
- *
- * Returns: Nothing, modifies BST, modifes book->num_occupied up to date, adds
- *  order and arranges memory. Uses sift_up for ordering
  */
 void insert(book_t *book, order_t *inc_order);
 
@@ -93,18 +190,32 @@ void insert(book_t *book, order_t *inc_order);
  */
 order_t *best_order(book_t *book);
 
+/* 
+ * find_resting: Finds the resting order with the given oref through the
+ * book's oref index
+ * 
+ * book: Book to search
+ * oref: oref to look for
+ *
+ * Returns: the resting order, or NULL if there isn't one
+ */
+order_t *find_resting(book_t *book, long long oref);
+
 /* 
  * compute_cancel: Removes a cancel order from a book if possible
- * Logic of doing compute_cancel in book.c is because doing the array work
+ * Logic of doing compute_cancel in book.c is because doing the ladder work
  * in exchange.c would enable exchange.c to see the length/ amount of orders
- * in the current heap if the cancel DNE. This felt like a violation of the 
+ * in the current book if the cancel DNE. This felt like a violation of the 
  * opaqueness of the book type. Compute cancel considers the logic of cancels
- * and removes orders appropriately
+ * and removes orders appropriately. The resting order is found through the
+ * book's oref index (find_resting), so a cancel does not depend on the 
+ * depth of the book
  * 
  * book: Book to query for a cancel order
  * order: Incoming cancel order
  * out: out paremeter set to cancel order to add to action report later
- *
+ * sv: flag to not free shares of order if there are remaining shares
+ * 
  * Returns: None. Modifes the book if appropriate and sets out parameter
  */
 void compute_cancel(book_t *book, order_t *order, order_t **out, bool *sv);
@@ -0,0 +1,51 @@
+/*
+ * CS 152, Spring 2022
+ * Book Backend Interface: what a book representation provides.
+ *
+ * Only book.c and the representations (book_ladder.c, book_heap.c,
+ * book_list.c) include this file. A representation keeps its own book
+ * structure with a book_t as the first member, and points that member at
+ * its operations table, so book.c can pass each public book function on
+ * to whichever representation the book was made with.
+ */
+
+#ifndef BOOK_BACKEND_H
+#define BOOK_BACKEND_H
+
+/* The operations every representation implements. Resting orders are
+ * never copied: the book holds the order_t pointers it is given.
+ */
+struct book_ops {
+    const char *name;
+
+    /* makes an empty book, with its base filled in */
+    book_t *(*make)(enum book_type type);
+
+    /* frees the book and every order still resting in it */
+    void (*free)(book_t *book);
+
+    /* adds an order, behind any order with priority over it */
+    void (*insert)(book_t *book, order_t *order);
+
+    /* the order with priority over every other, NULL if empty */
+    order_t *(*best)(book_t *book);
+
+    /* removes a resting order (the best, or any other) without freeing */
+    void (*remove)(book_t *book, order_t *order);
+
+    /* the resting order with an oref, NULL if there isn't one */
+    order_t *(*find)(book_t *book, long long oref);
+
+    /* calls fn on every resting order, in the representation's own
+     * order, which need not be priority order */
+    void (*iterate)(book_t *book, void (*fn)(void *ctx, order_t *order),
+                    void *ctx);
+};
+
+/* The part of a book that every representation shares */
+struct book {
+    const book_ops_t *ops;
+    enum book_type type;
+};
+
+#endif
@@ -0,0 +1,285 @@
+/*
+ * CS 152, Spring 2022
+ * Book Data Structure Implementation: indexed binary heap
+ * 
+ * You will modify this file.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "order.h"
+#include "book.h"
+#include "book_backend.h"
+#include "oref_index.h"
+#include "util.h"
+ 
+/* The heap only ever moves order pointers, and every order keeps its
+ * current slot in order->slot. That lets rm_val remove any order with a
+ * single sift from where it sits, and the orders themselves never move,
+ * so pointers held by the oref index stay valid.
+ */
+typedef struct heap_book {
+    book_t base;
+    int num_slots;
+    int num_occupied;
+    order_t **array;
+    oref_index_t *orefs;      // every resting order, by oref
+} heap_book_t;
+
+#define INIT_SLOTS 10
+#define SLOTS_MULTIPLIER 2
+
+/* 
+ * heap_make: Creates a new book with an empty heap
+ *
+ * val: enum book_type indicating what type the book should have
+ * 
+ * Returns: Initalized book
+ */
+static book_t *heap_make(enum book_type val){
+    heap_book_t *out = (heap_book_t*)malloc(sizeof(heap_book_t));
+    if (out == NULL) {
+        fprintf(stderr, "book_t: Unable to allocate\n");
+        exit(1);
+    }
+    out->base.ops = &book_heap_ops;
+    out->base.type = val;
+    out->num_slots = INIT_SLOTS;
+    out->num_occupied = 0;
+    out->array= (order_t**)malloc(sizeof(order_t*) * INIT_SLOTS);
+    if (out->array == NULL) {
+        fprintf(stderr, "book_t: Unable to allocate\n");
+        exit(1);
+    }
+    out->orefs = mk_oref_index();
+    return &out->base;
+}
+
+
+/* 
+ * heap_free: Frees all values in a book
+ *
+ * base: book to be freed
+ * 
+ * Returns: Nothing
+ */
+static void heap_free(book_t *base){
+    heap_book_t *value = (heap_book_t *) base;
+    for (int i = 0; i < value->num_occupied; i++) {
+        free_order(value->array[i]);
+    }
+    free(value->array);
+    free_oref_index(value->orefs);
+    free (value);
+}
+
+
+/* 
+ * heap_iterate: Calls a function on every order in a book (in heap order,
+ * not priority order)
+ *
+ * base: the book
+ * fn: the function, given ctx and the order
+ * ctx: passed to fn
+ */
+static void heap_iterate(book_t *base, void (*fn)(void *ctx, order_t *order),
+                         void *ctx){
+    heap_book_t *book = (heap_book_t *) base;
+    for (int i = 0; i < book->num_occupied; i++) {
+        fn(ctx, book->array[i]);
+    }
+}
+
+
+/* 
+ * parent: returns parent index of a node in the heap
+ *
+ * Returns: Int, parent index
+ */
+static int parent(int val){
+    return (val - 1) / 2;
+}
+
+/* 
+ * left_child: returns left child index of a node in the heap
+ *
+ * Returns: Int, left child index
+ */
+static int left_child(int val){
+    return (val * 2) + 1;
+}
+
+/* 
+ * place: puts an order in a heap slot and records the slot in the order
+ *
+ * array: array of orders (in heap ordering)
+ * index: slot to fill
+ * order: order to put there
+ */
+static void place(order_t *array[], int index, order_t *order) {
+    array[index] = order;
+    order->slot = index;
+}
+
+
+/* 
+ * sift_up: moves the order at index up toward the root until its parent
+ * has priority over it. Parents are shifted down into the hole and the
+ * order is written once, at its final slot
+ *
+ * array: array of orders (in heap ordering)
+ * index: slot of the order to move
+ *
+ * Returns: Nothing, modifies the heap
+ */
+static void sift_up(order_t *array[], int index) {
+    order_t *moving = array[index];
+    while (index > 0) {
+        int parent_index = parent(index);
+        if (!order_cmp(moving, array[parent_index])) {
+            break;
+        }
+        place(array, index, array[parent_index]);
+        index = parent_index;
+    }
+    place(array, index, moving);
+}
+
+
+/* 
+ * sift_down: moves the order at index down until neither child has
+ * priority over it. Children are shifted up into the hole and the order
+ * is written once, at its final slot
+ *
+ * array: array of orders (in heap ordering)
+ * size: number of orders in the heap
+ * index: slot of the order to move
+ *
+ * Returns: Nothing, modifies the heap
+ */
+static void sift_down(order_t *array[], int size, int index){
+    order_t *moving = array[index];
+    while (true) {
+        int child = left_child(index);
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && order_cmp(array[child + 1], array[child])) {
+            child++;
+        }
+        if (!order_cmp(array[child], moving)) {
+            break;
+        }
+        place(array, index, array[child]);
+        index = child;
+    }
+    place(array, index, moving);
+}
+
+
+/* 
+ * heap_remove: Removes a resting order from the book. The order itself is
+ * not freed. The last order in the heap fills the removed order's slot and
+ * is sifted up or down from there
+ * 
+ * base: Where the value is to be removed from
+ * order: the resting order to be removed
+ *
+ * Returns: Nothing, modifies the heap, keeps book->num_occupied up to date
+ */
+static void heap_remove(book_t *base, order_t *order){
+    heap_book_t *book = (heap_book_t *) base;
+    int index = order->slot;
+    assert(index >= 0 && index < book->num_occupied);
+    assert(book->array[index] == order);
+    unindex_order(book->orefs, order);
+    order->slot = -1;
+
+    book->num_occupied--;
+    int last = book->num_occupied;
+    if (index == last) {
+        return;
+    }
+    place(book->array, index, book->array[last]);
+    if (index > 0 && order_cmp(book->array[index], 
+                               book->array[parent(index)])) {
+        sift_up(book->array, index);
+    } else {
+        sift_down(book->array, book->num_occupied, index);
+    }
+}
+
+/* 
+ * heap_insert: Inserts a value into a book in the appropriate place.
+ * Modifes memory as needed
+ * 
+ * base: Book where the value is to be added to
+ * inc_order: incoming order to be added
+ *
+ * Returns: Nothing, modifies the heap, modifes book->num_occupied up to date,
+ *  adds order and arranges memory. Uses sift_up for ordering
+ */
+static void heap_insert(book_t *base, order_t *inc_order) {
+    heap_book_t *book = (heap_book_t *) base;
+    int nt = book->num_occupied;
+    int ns = book->num_slots;
+
+    if (nt == ns) {
+        int new_num_slots = (int) (ns * SLOTS_MULTIPLIER);
+        book->array = (order_t **) ck_realloc(book->array, 
+					      sizeof(order_t*) * new_num_slots, 
+					      "heap_insert");
+        book->num_slots = new_num_slots;
+        ns = new_num_slots;
+    }    
+    assert(nt < ns);
+    book->array[nt] = inc_order;
+    book->num_occupied++;
+    sift_up(book->array, nt);
+    index_order(book->orefs, inc_order);
+}
+
+
+/* 
+ * heap_best: Returns the "best order" for a book: the root of the heap.
+ * If book is empty, returns NULL
+ * 
+ * base: Book where the order is to be drawn from
+ *
+ * Returns: Desired order if book is not empty, otherwise NULL
+ */
+static order_t *heap_best(book_t *base){
+    heap_book_t *book = (heap_book_t *) base;
+    if (book->num_occupied == 0){
+        return NULL;
+    }
+    return book->array[0];
+}
+
+
+/* 
+ * heap_find: Finds the resting order with the given oref through the
+ * book's oref index
+ * 
+ * base: Book to search
+ * oref: oref to look for
+ *
+ * Returns: the resting order, or NULL if there isn't one
+ */
+static order_t *heap_find(book_t *base, long long oref){
+    return lookup_oref(((heap_book_t *) base)->orefs, oref);
+}
+
+const book_ops_t book_heap_ops = {
+    .name = "heap",
+    .make = heap_make,
+    .free = heap_free,
+    .insert = heap_insert,
+    .best = heap_best,
+    .remove = heap_remove,
+    .find = heap_find,
+    .iterate = heap_iterate,
+};
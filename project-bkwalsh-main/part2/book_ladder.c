@@ -0,0 +1,386 @@
+/*
+ * CS 152, Spring 2022
+ * Book Data Structure Implementation: price level ladder
+ * 
+ * You will modify this file.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "order.h"
+#include "book.h"
+#include "book_backend.h"
+#include "oref_index.h"
+#include "util.h"
+ 
+
+/* A price level holds every resting order at one price, oldest first.
+ * The orders are linked through their next/prev fields so a level can
+ * be walked, appended to and unlinked from without moving anything.
+ */
+typedef struct price_level {
+    long long price;
+    int num_orders;
+    order_t *head;   // oldest order, the next to trade at this price
+    order_t *tail;   // newest order
+    struct price_level *next_spare;
+} price_level_t;
+
+/* The book is a ladder of price levels sorted from worst to best price,
+ * so the best level is always the last one and can be popped without
+ * shifting the rest of the array.
+ */
+typedef struct ladder_book {
+    book_t base;
+    int num_occupied;         // number of resting orders
+    int num_levels;           // number of non-empty price levels
+    int num_slots;            // number of slots in levels
+    price_level_t **levels;   // levels, worst price first
+    oref_index_t *orefs;      // every resting order, by oref
+    price_level_t *spare;     // emptied levels kept for reuse, linked by
+                              // their next_spare field
+} ladder_book_t;
+
+#define INIT_SLOTS 10
+#define SLOTS_MULTIPLIER 2
+
+/* 
+ * ladder_make: Creates a new book with an empty ladder
+ *
+ * val: enum book_type indicating what type the book should have
+ * 
+ * Returns: Initalized book
+ */
+static book_t *ladder_make(enum book_type val){
+    ladder_book_t *out = (ladder_book_t*)malloc(sizeof(ladder_book_t));
+    if (out == NULL) {
+        fprintf(stderr, "book_t: Unable to allocate\n");
+        exit(1);
+    }
+    out->base.ops = &book_ladder_ops;
+    out->base.type = val;
+    out->num_occupied = 0;
+    out->num_levels = 0;
+    out->num_slots = INIT_SLOTS;
+    out->levels = (price_level_t**)malloc(sizeof(price_level_t*) * INIT_SLOTS);
+    if (out->levels == NULL) {
+        fprintf(stderr, "book_t: Unable to allocate\n");
+        exit(1);
+    }
+    out->orefs = mk_oref_index();
+    out->spare = NULL;
+    return &out->base;
+}
+
+
+/* 
+ * free_level: Frees a price level and every order resting on it
+ *
+ * level: level to be freed
+ * 
+ * Returns: Nothing
+ */
+static void free_level(price_level_t *level){
+    order_t *curr = level->head;
+    while (curr != NULL) {
+        order_t *next = curr->next;
+        free_order(curr);
+        curr = next;
+    }
+    free(level);
+}
+
+/* 
+ * ladder_free: Frees all values in a book
+ *
+ * base: book to be freed
+ * 
+ * Returns: Nothing
+ */
+static void ladder_free(book_t *base){
+    ladder_book_t *value = (ladder_book_t *) base;
+    for (int i = 0; i < value->num_levels; i++) {
+        free_level(value->levels[i]);
+    }
+    while (value->spare != NULL) {
+        price_level_t *next = value->spare->next_spare;
+        free(value->spare);
+        value->spare = next;
+    }
+    free(value->levels);
+    free_oref_index(value->orefs);
+    free (value);
+}
+
+
+/* 
+ * ladder_iterate: Calls a function on every order in a book, best price
+ * first and oldest order first within a price
+ *
+ * base: the book
+ * fn: the function, given ctx and the order
+ * ctx: passed to fn
+ */
+static void ladder_iterate(book_t *base, 
+                           void (*fn)(void *ctx, order_t *order), void *ctx){
+    ladder_book_t *book = (ladder_book_t *) base;
+    for (int i = book->num_levels - 1; i >= 0; i--) {
+        for (order_t *curr = book->levels[i]->head; curr != NULL; 
+            curr = curr->next) {
+            fn(ctx, curr);
+        }
+    }
+}
+
+
+
+/* 
+ * better_price: Checks if price p1 has priority over price p2 in a book.
+ * Buy books favor higher prices, sell books favor lower prices
+ *
+ * Returns: boolean, true if p1 is a better price than p2
+ */
+static bool better_price(ladder_book_t *book, long long p1, long long p2){
+    if (book->base.type == BUY_BOOK) {
+        return p1 > p2;
+    } 
+    return p1 < p2;
+}
+
+/* 
+ * find_level: Binary searches the ladder for a price. 
+ *
+ * book: book to search
+ * price: price to look for
+ * found: out parameter set to true if a level with this price exists
+ *
+ * Returns: index of the level with the price if found, otherwise the index
+ *  where a level with that price would have to be inserted
+ */
+static int find_level(ladder_book_t *book, long long price, bool *found){
+    int lo = 0;
+    int hi = book->num_levels;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        long long mid_price = book->levels[mid]->price;
+        if (mid_price == price) {
+            *found = true;
+            return mid;
+        } else if (better_price(book, price, mid_price)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *found = false;
+    return lo;
+}
+
+/* 
+ * add_level: Makes a new empty price level and places it in the ladder
+ * at the given index, growing the ladder if needed. Reuses a spare level
+ * if the book has one
+ *
+ * book: book to add the level to
+ * index: index the new level should have (from find_level)
+ * price: price of the new level
+ *
+ * Returns: the new level
+ */
+static price_level_t *add_level(ladder_book_t *book, int index, 
+                                long long price){
+    if (book->num_levels == book->num_slots) {
+        int new_num_slots = book->num_slots * SLOTS_MULTIPLIER;
+        book->levels = (price_level_t **) ck_realloc(book->levels,
+                                  sizeof(price_level_t*) * new_num_slots,
+                                  "add_level");
+        book->num_slots = new_num_slots;
+    }
+    price_level_t *level = book->spare;
+    if (level != NULL) {
+        book->spare = level->next_spare;
+    } else {
+        level = (price_level_t*) ck_malloc(sizeof(price_level_t), 
+                                           "add_level");
+    }
+    level->price = price;
+    level->num_orders = 0;
+    level->head = NULL;
+    level->tail = NULL;
+    for (int i = book->num_levels; i > index; i--) {
+        book->levels[i] = book->levels[i - 1];
+    }
+    book->levels[index] = level;
+    book->num_levels++;
+    return level;
+}
+
+/* 
+ * rm_level: Removes an empty price level from the ladder and keeps it as
+ * a spare, so a sweep through the book never hands memory back just to
+ * ask for it again. Removing the best level is O(1) since it is the last
+ * one.
+ *
+ * book: book the level is in
+ * level: the (empty) level to remove
+ *
+ * Returns: Nothing
+ */
+static void rm_level(ladder_book_t *book, price_level_t *level){
+    assert(level->num_orders == 0);
+    int index = book->num_levels - 1;
+    if (book->levels[index] != level) {
+        bool found;
+        index = find_level(book, level->price, &found);
+        assert(found);
+    }
+    for (int i = index; i < book->num_levels - 1; i++) {
+        book->levels[i] = book->levels[i + 1];
+    }
+    book->num_levels--;
+    level->next_spare = book->spare;
+    book->spare = level;
+}
+
+/* 
+ * append_to_level: Adds an order to the back of a price level's queue.
+ * Orders normally arrive in time order so this is O(1), but a delayed
+ * order is walked back to its place so time priority still holds.
+ *
+ * level: level to add to
+ * inc_order: order to be added
+ *
+ * Returns: Nothing
+ */
+static void append_to_level(price_level_t *level, order_t *inc_order){
+    order_t *after = level->tail;
+    while (after != NULL && order_cmp(inc_order, after)) {
+        after = after->prev;
+    }
+    inc_order->prev = after;
+    if (after == NULL) {
+        inc_order->next = level->head;
+        level->head = inc_order;
+    } else {
+        inc_order->next = after->next;
+        after->next = inc_order;
+    }
+    if (inc_order->next == NULL) {
+        level->tail = inc_order;
+    } else {
+        inc_order->next->prev = inc_order;
+    }
+    inc_order->level = level;
+    level->num_orders++;
+}
+
+
+/* 
+ * ladder_remove: Removes a resting order from the book. The order itself
+ * is not freed. Drops the order's price level if it is left empty
+ * 
+ * base: Where the value is to be removed from
+ * order: the resting order to be removed
+ *
+ * Returns: Nothing, modifies the ladder, keeps book->num_occupied up to date
+ */
+static void ladder_remove(book_t *base, order_t *order){
+    ladder_book_t *book = (ladder_book_t *) base;
+    price_level_t *level = order->level;
+    assert(level != NULL);
+    if (order->prev == NULL) {
+        level->head = order->next;
+    } else {
+        order->prev->next = order->next;
+    }
+    if (order->next == NULL) {
+        level->tail = order->prev;
+    } else {
+        order->next->prev = order->prev;
+    }
+    order->next = NULL;
+    order->prev = NULL;
+    order->level = NULL;
+    unindex_order(book->orefs, order);
+    level->num_orders--;
+    book->num_occupied--;
+    if (level->num_orders == 0) {
+        rm_level(book, level);
+    }
+}
+
+/* 
+ * ladder_insert: Inserts a value into a book in the appropriate place.
+ * Modifes memory as needed
+ * 
+ * base: Book where the value is to be added to
+ * inc_order: incoming order to be added
+ *
+ * Returns: Nothing, modifies the ladder, modifes book->num_occupied up to 
+ *  date. Orders at an existing price are appended to that level's queue, 
+ *  checking the best level before searching the rest of the ladder
+ */
+static void ladder_insert(book_t *base, order_t *inc_order) {
+    ladder_book_t *book = (ladder_book_t *) base;
+    price_level_t *level = NULL;
+    int nl = book->num_levels;
+    if (nl > 0 && book->levels[nl - 1]->price == inc_order->price) {
+        level = book->levels[nl - 1];
+    } else {
+        bool found;
+        int index = find_level(book, inc_order->price, &found);
+        if (found) {
+            level = book->levels[index];
+        } else {
+            level = add_level(book, index, inc_order->price);
+        }
+    }
+    append_to_level(level, inc_order);
+    index_order(book->orefs, inc_order);
+    book->num_occupied++;
+}
+
+
+/* 
+ * ladder_best: Returns the "best order" for a book: the oldest order at
+ * the best price. If book is empty, returns NULL
+ * 
+ * base: Book where the order is to be drawn from
+ *
+ * Returns: Desired order if book is not empty, otherwise NULL
+ */
+static order_t *ladder_best(book_t *base){
+    ladder_book_t *book = (ladder_book_t *) base;
+    if (book->num_levels == 0){
+        return NULL;
+    }
+    return book->levels[book->num_levels - 1]->head;
+}
+
+
+/* 
+ * ladder_find: Finds the resting order with the given oref through the
+ * book's oref index
+ * 
+ * base: Book to search
+ * oref: oref to look for
+ *
+ * Returns: the resting order, or NULL if there isn't one
+ */
+static order_t *ladder_find(book_t *base, long long oref){
+    return lookup_oref(((ladder_book_t *) base)->orefs, oref);
+}
+
+const book_ops_t book_ladder_ops = {
+    .name = "ladder",
+    .make = ladder_make,
+    .free = ladder_free,
+    .insert = ladder_insert,
+    .best = ladder_best,
+    .remove = ladder_remove,
+    .find = ladder_find,
+    .iterate = ladder_iterate,
+};
@@ -0,0 +1,179 @@
+/*
+ * CS 152, Spring 2022
+ * Book Data Structure Implementation: sorted linked list
+ *
+ * You will modify this file.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "order.h"
+#include "book.h"
+#include "book_backend.h"
+#include "oref_index.h"
+#include "util.h"
+
+
+/* The part1 book: every resting order in one list, best first. The
+ * orders are linked through their next/prev fields into a circle that
+ * starts and ends at a sentinel, so the best order is head.next, the
+ * worst is head.prev, and nothing needs a special case for an empty
+ * list. Inserting walks from the worst end, where orders that arrive in
+ * time order at an existing price belong, so it costs the number of
+ * orders with a worse price.
+ */
+typedef struct list_book {
+    book_t base;
+    int num_occupied;
+    order_t head;             // sentinel, never a real order
+    oref_index_t *orefs;      // every resting order, by oref
+} list_book_t;
+
+/*
+ * list_make: Creates a new book with an empty list
+ *
+ * val: enum book_type indicating what type the book should have
+ *
+ * Returns: Initalized book
+ */
+static book_t *list_make(enum book_type val){
+    list_book_t *out = (list_book_t*)malloc(sizeof(list_book_t));
+    if (out == NULL) {
+        fprintf(stderr, "book_t: Unable to allocate\n");
+        exit(1);
+    }
+    out->base.ops = &book_list_ops;
+    out->base.type = val;
+    out->num_occupied = 0;
+    out->head.next = &out->head;
+    out->head.prev = &out->head;
+    out->orefs = mk_oref_index();
+    return &out->base;
+}
+
+
+/*
+ * list_free: Frees all values in a book
+ *
+ * base: book to be freed
+ *
+ * Returns: Nothing
+ */
+static void list_free(book_t *base){
+    list_book_t *value = (list_book_t *) base;
+    order_t *curr = value->head.next;
+    while (curr != &value->head) {
+        order_t *next = curr->next;
+        free_order(curr);
+        curr = next;
+    }
+    free_oref_index(value->orefs);
+    free (value);
+}
+
+
+/*
+ * list_iterate: Calls a function on every order in a book, best first
+ *
+ * base: the book
+ * fn: the function, given ctx and the order
+ * ctx: passed to fn
+ */
+static void list_iterate(book_t *base, void (*fn)(void *ctx, order_t *order),
+                         void *ctx){
+    list_book_t *book = (list_book_t *) base;
+    for (order_t *curr = book->head.next; curr != &book->head;
+         curr = curr->next) {
+        fn(ctx, curr);
+    }
+}
+
+
+/*
+ * list_remove: Removes a resting order from the book. The order itself
+ * is not freed
+ *
+ * base: Where the value is to be removed from
+ * order: the resting order to be removed
+ *
+ * Returns: Nothing, modifies the list, keeps book->num_occupied up to date
+ */
+static void list_remove(book_t *base, order_t *order){
+    list_book_t *book = (list_book_t *) base;
+    assert(order->next != NULL && order->prev != NULL);
+    order->prev->next = order->next;
+    order->next->prev = order->prev;
+    order->next = NULL;
+    order->prev = NULL;
+    unindex_order(book->orefs, order);
+    book->num_occupied--;
+}
+
+/*
+ * list_insert: Inserts a value into a book in the appropriate place,
+ * behind every order with priority over it
+ *
+ * base: Book where the value is to be added to
+ * inc_order: incoming order to be added
+ *
+ * Returns: Nothing, modifies the list, modifes book->num_occupied up to
+ *  date
+ */
+static void list_insert(book_t *base, order_t *inc_order) {
+    list_book_t *book = (list_book_t *) base;
+    order_t *after = book->head.prev;
+    while (after != &book->head && order_cmp(inc_order, after)) {
+        after = after->prev;
+    }
+    inc_order->prev = after;
+    inc_order->next = after->next;
+    after->next->prev = inc_order;
+    after->next = inc_order;
+    index_order(book->orefs, inc_order);
+    book->num_occupied++;
+}
+
+
+/*
+ * list_best: Returns the "best order" for a book: the first in the list.
+ * If book is empty, returns NULL
+ *
+ * base: Book where the order is to be drawn from
+ *
+ * Returns: Desired order if book is not empty, otherwise NULL
+ */
+static order_t *list_best(book_t *base){
+    list_book_t *book = (list_book_t *) base;
+    if (book->num_occupied == 0){
+        return NULL;
+    }
+    return book->head.next;
+}
+
+
+/*
+ * list_find: Finds the resting order with the given oref through the
+ * book's oref index
+ *
+ * base: Book to search
+ * oref: oref to look for
+ *
+ * Returns: the resting order, or NULL if there isn't one
+ */
+static order_t *list_find(book_t *base, long long oref){
+    return lookup_oref(((list_book_t *) base)->orefs, oref);
+}
+
+const book_ops_t book_list_ops = {
+    .name = "list",
+    .make = list_make,
+    .free = list_free,
+    .insert = list_insert,
+    .best = list_best,
+    .remove = list_remove,
+    .find = list_find,
+    .iterate = list_iterate,
+};
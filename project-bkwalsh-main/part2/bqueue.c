@@ -0,0 +1,94 @@
+/*
+ * CS 152, Spring 2022
+ * Bounded Queue
+ *
+ * A circular array guarded by a mutex, with one condition variable for
+ * each side to sleep on.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "bqueue.h"
+#include "util.h"
+
+struct bqueue {
+    void **items;
+    int capacity;
+    int head;                   // slot of the front item
+    int count;                  // number of items in the queue
+    pthread_mutex_t lock;
+    pthread_cond_t not_full;
+    pthread_cond_t not_empty;
+};
+
+/*
+ * mk_bqueue: make an empty queue
+ *
+ * capacity: the most items the queue holds at once
+ *
+ * Returns: a queue
+ */
+bqueue_t *mk_bqueue(int capacity) {
+    assert(capacity > 0);
+    bqueue_t *q = (bqueue_t *) ck_malloc(sizeof(bqueue_t), "mk_bqueue");
+    q->items = (void **) ck_malloc(sizeof(void *) * capacity, "mk_bqueue");
+    q->capacity = capacity;
+    q->head = 0;
+    q->count = 0;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    return q;
+}
+
+/*
+ * free_bqueue: free a queue
+ *
+ * q: the queue
+ */
+void free_bqueue(bqueue_t *q) {
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->not_full);
+    pthread_cond_destroy(&q->not_empty);
+    ck_free(q->items);
+    ck_free(q);
+}
+
+/*
+ * bqueue_push: add an item to the back of the queue, waiting for room
+ *
+ * q: the queue
+ * item: the item
+ */
+void bqueue_push(bqueue_t *q, void *item) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->capacity) {
+        pthread_cond_wait(&q->not_full, &q->lock);
+    }
+    q->items[(q->head + q->count) % q->capacity] = item;
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/*
+ * bqueue_pop: take the item at the front of the queue, waiting for one
+ *
+ * q: the queue
+ *
+ * Returns: the item
+ */
+void *bqueue_pop(bqueue_t *q) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0) {
+        pthread_cond_wait(&q->not_empty, &q->lock);
+    }
+    void *item = q->items[q->head];
+    q->head = (q->head + 1) % q->capacity;
+    q->count--;
+    pthread_cond_signal(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+    return item;
+}
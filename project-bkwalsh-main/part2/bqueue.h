@@ -0,0 +1,50 @@
+/*
+ * CS 152, Spring 2022
+ * Bounded Queue Interface.
+ *
+ * A fixed size FIFO of pointers shared between threads. bqueue_push
+ * waits while the queue is full and bqueue_pop waits while it is empty,
+ * so a fast stage can never run more than the queue's capacity ahead of
+ * a slow one.
+ */
+
+#ifndef BQUEUE_H
+#define BQUEUE_H
+
+/* The queue type is opaque */
+typedef struct bqueue bqueue_t;
+
+/*
+ * mk_bqueue: make an empty queue
+ *
+ * capacity: the most items the queue holds at once
+ *
+ * Returns: a queue
+ */
+bqueue_t *mk_bqueue(int capacity);
+
+/*
+ * free_bqueue: free a queue. Items still in it are not freed.
+ *
+ * q: the queue
+ */
+void free_bqueue(bqueue_t *q);
+
+/*
+ * bqueue_push: add an item to the back of the queue, waiting for room
+ *
+ * q: the queue
+ * item: the item
+ */
+void bqueue_push(bqueue_t *q, void *item);
+
+/*
+ * bqueue_pop: take the item at the front of the queue, waiting for one
+ *
+ * q: the queue
+ *
+ * Returns: the item
+ */
+void *bqueue_pop(bqueue_t *q);
+
+#endif
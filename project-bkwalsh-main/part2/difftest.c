@@ -0,0 +1,344 @@
+/*
+ * CS 152, Spring 2022
+ * Differential Test
+ *
+ * Runs one orders file through several matching engines and checks that
+ * they produce the same actions, action by action, and reports how fast
+ * each engine was:
+ *
+ *   ./genorders -n 100000 -c 0 diff_orders.csv diff_times.csv
+ *   ./difftest diff_orders.csv
+ *   ./difftest diff_orders.csv heap list
+ *
+ * An engine is part1, the linked list exchange in ../part1 (run through
+ * its replay tool, see -r), or the name of a book representation here:
+ * ladder, heap or list. The default is part1 followed by every
+ * representation. The first engine is the reference the others are
+ * checked against. part1 has no cancels, so it only takes streams of
+ * adds (genorders -c 0); by default it is left out of other streams.
+ * Every order must be for the same ticker.
+ *
+ * Each engine processes the orders one line at a time, at the time given
+ * by the line number, and writes its actions to a file the way simulate
+ * does; the time taken covers both. The results go to stdout as CSV:
+ *
+ *   engine,orders,actions,ns_per_order,orders_per_sec,matches
+ *
+ * The first action an engine gets wrong goes to stderr, next to the
+ * reference's, and difftest exits with status 1.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "order.h"
+#include "book.h"
+#include "action_report.h"
+#include "exchange.h"
+#include "symbols.h"
+#include "util.h"
+
+#define PART1_REPLAY "../part1/replay"
+#define PART1_ENGINE "part1"
+#define MAX_LINE_LEN 1000
+#define MAX_ENGINES 16
+#define INIT_LINES 1024
+
+/* One engine's run: its actions, and how long they took */
+typedef struct run {
+    const char *engine;
+    FILE *actions;              // read from the start
+    long num_actions;
+    double elapsed_ns;
+} run_t;
+
+/*
+ * now_ns: reads the monotonic clock
+ *
+ * Returns: time in nanoseconds
+ */
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * read_lines: reads every line of a file into memory
+ *
+ * filename: the file
+ * num_lines: out parameter for the number of lines read
+ *
+ * Returns: array of lines (newlines removed)
+ */
+static char **read_lines(char *filename, int *num_lines) {
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "difftest: cannot open %s\n", filename);
+        exit(1);
+    }
+    int n = 0;
+    int slots = INIT_LINES;
+    char **lines = (char **) ck_malloc(sizeof(char *) * slots, "read_lines");
+    char buffer[MAX_LINE_LEN];
+    while (fgets(buffer, MAX_LINE_LEN, fp) != NULL) {
+        buffer[strcspn(buffer, "\n")] = '\0';
+        if (n == slots) {
+            slots *= 2;
+            lines = (char **) ck_realloc(lines, sizeof(char *) * slots,
+                                         "read_lines");
+        }
+        lines[n++] = ck_strdup(buffer, "read_lines");
+    }
+    fclose(fp);
+    *num_lines = n;
+    return lines;
+}
+
+/*
+ * check_orders: makes sure every line is an order for the same ticker
+ *
+ * lines: the orders
+ * num_lines: how many there are
+ * has_cancels: out parameter set to true if any order is a cancel
+ *
+ * Returns: the interned ticker
+ */
+static int check_orders(char **lines, int num_lines, bool *has_cancels) {
+    int symbol = -1;
+    *has_cancels = false;
+    for (int i = 0; i < num_lines; i++) {
+        order_msg_t msg;
+        enum parse_status status = parse_order_line(lines[i], &msg);
+        if (status != PARSE_OK) {
+            fprintf(stderr, "difftest: line %d: %s: %s\n", i + 1,
+                    parse_status_str(status), lines[i]);
+            exit(1);
+        }
+        if (symbol < 0) {
+            symbol = msg.symbol;
+        } else if (msg.symbol != symbol) {
+            fprintf(stderr, "difftest: line %d is not for %s: %s\n", i + 1,
+                    symbol_name(symbol), lines[i]);
+            exit(1);
+        }
+        if (msg.type == 'C') {
+            *has_cancels = true;
+        }
+    }
+    if (symbol < 0) {
+        fprintf(stderr, "difftest: no orders\n");
+        exit(1);
+    }
+    return symbol;
+}
+
+/*
+ * run_book: runs the orders through an exchange here
+ *
+ * ops: the exchange's book representation
+ * symbol: the ticker
+ * lines: the orders
+ * num_lines: how many there are
+ * run: filled in
+ */
+static void run_book(const book_ops_t *ops, int symbol, char **lines,
+                     int num_lines, run_t *run) {
+    run->actions = tmpfile();
+    if (run->actions == NULL) {
+        fprintf(stderr, "difftest: cannot make a temporary file\n");
+        exit(1);
+    }
+    exchange_t *exchange = mk_exchange_book(symbol_name(symbol), ops);
+    double start = now_ns();
+    for (int i = 0; i < num_lines; i++) {
+        action_report_t *ar = process_order(exchange, lines[i], i);
+        write_action_report_to_file(ar, run->actions, i);
+        free_action_report(ar);
+    }
+    fflush(run->actions);
+    run->elapsed_ns = now_ns() - start;
+    free_exchange(exchange);
+    rewind(run->actions);
+}
+
+/*
+ * run_part1: runs the orders file through part1's replay tool
+ *
+ * replay: path to the tool
+ * orders: path to the orders file
+ * num_lines: how many orders it has
+ * run: filled in
+ */
+static void run_part1(char *replay, char *orders, int num_lines, run_t *run) {
+    char path[] = "/tmp/difftest_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        fprintf(stderr, "difftest: cannot make a temporary file\n");
+        exit(1);
+    }
+    char cmd[3 * MAX_LINE_LEN];
+    snprintf(cmd, sizeof(cmd), "'%s' '%s' '%s'", replay, orders, path);
+    FILE *out = popen(cmd, "r");
+    long num_orders = -1;
+    if (out == NULL || fscanf(out, "%ld,%lf", &num_orders,
+                              &run->elapsed_ns) != 2) {
+        num_orders = -1;
+    }
+    if (out == NULL || pclose(out) != 0 || num_orders != num_lines) {
+        fprintf(stderr, "difftest: %s failed (make -C ../part1 replay "
+                "builds it)\n", replay);
+        unlink(path);
+        exit(1);
+    }
+    run->actions = fdopen(fd, "r");
+    assert(run->actions != NULL);
+    unlink(path);
+}
+
+/*
+ * next_action: reads the next action line of a run
+ *
+ * Returns: false once there are no more
+ */
+static bool next_action(run_t *run, char *line) {
+    if (fgets(line, MAX_LINE_LEN, run->actions) == NULL) {
+        strcpy(line, "(none)\n");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * compare_runs: checks a run against the reference, action by action
+ *
+ * Returns: true if they match
+ */
+static bool compare_runs(run_t *ref, run_t *run) {
+    char ref_line[MAX_LINE_LEN];
+    char line[MAX_LINE_LEN];
+    rewind(ref->actions);
+    run->num_actions = 0;
+    while (true) {
+        bool ref_more = next_action(ref, ref_line);
+        bool more = next_action(run, line);
+        if (!ref_more && !more) {
+            return true;
+        }
+        if (!ref_more || !more || strcmp(ref_line, line) != 0) {
+            fprintf(stderr, "difftest: %s differs from %s at action %ld\n"
+                    "  %s: %s  %s: %s", run->engine, ref->engine,
+                    run->num_actions + 1, ref->engine, ref_line,
+                    run->engine, line);
+            return false;
+        }
+        run->num_actions++;
+    }
+}
+
+/*
+ * usage: print how to run difftest and exit
+ */
+static void usage() {
+    fprintf(stderr, "usage: difftest [-r part1 replay] <orders file> "
+            "[engine ...]\n");
+    fprintf(stderr, "  engines: %s", PART1_ENGINE);
+    for (int i = 0; book_ops_at(i) != NULL; i++) {
+        fprintf(stderr, ", %s", book_ops_name(book_ops_at(i)));
+    }
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    char *replay = PART1_REPLAY;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:")) != -1) {
+        if (opt == 'r') {
+            replay = optarg;
+        } else {
+            usage();
+        }
+    }
+    if (optind >= argc) {
+        usage();
+    }
+    char *orders = argv[optind++];
+    int num_lines;
+    char **lines = read_lines(orders, &num_lines);
+    bool has_cancels;
+    int symbol = check_orders(lines, num_lines, &has_cancels);
+
+    const char *engines[MAX_ENGINES];
+    int num_engines = 0;
+    if (optind == argc) {
+        if (has_cancels) {
+            fprintf(stderr, "difftest: the orders have cancels, so %s is "
+                    "left out\n", PART1_ENGINE);
+        } else {
+            engines[num_engines++] = PART1_ENGINE;
+        }
+        for (int i = 0; book_ops_at(i) != NULL; i++) {
+            engines[num_engines++] = book_ops_name(book_ops_at(i));
+        }
+    }
+    for (; optind < argc && num_engines < MAX_ENGINES; optind++) {
+        if (strcmp(argv[optind], PART1_ENGINE) != 0 &&
+            find_book_ops(argv[optind]) == NULL) {
+            usage();
+        }
+        if (strcmp(argv[optind], PART1_ENGINE) == 0 && has_cancels) {
+            fprintf(stderr, "difftest: %s has no cancels, and the orders "
+                    "do\n", PART1_ENGINE);
+            exit(1);
+        }
+        engines[num_engines++] = argv[optind];
+    }
+
+    run_t runs[MAX_ENGINES];
+    bool all_match = true;
+    printf("engine,orders,actions,ns_per_order,orders_per_sec,matches\n");
+    for (int e = 0; e < num_engines; e++) {
+        run_t *run = &runs[e];
+        run->engine = engines[e];
+        if (strcmp(run->engine, PART1_ENGINE) == 0) {
+            run_part1(replay, orders, num_lines, run);
+        } else {
+            run_book(find_book_ops(run->engine), symbol, lines, num_lines,
+                     run);
+        }
+        char *matches = "reference";
+        if (e == 0) {
+            char line[MAX_LINE_LEN];
+            run->num_actions = 0;
+            while (next_action(run, line)) {
+                run->num_actions++;
+            }
+        } else if (compare_runs(&runs[0], run)) {
+            matches = "yes";
+        } else {
+            matches = "no";
+            all_match = false;
+        }
+        double ns = num_lines > 0 ? run->elapsed_ns / num_lines : 0;
+        printf("%s,%d,%ld,%.1f,%.0f,%s\n", run->engine, num_lines,
+               run->num_actions, ns, ns > 0 ? 1e9 / ns : 0, matches);
+        fflush(stdout);
+    }
+
+    for (int e = 0; e < num_engines; e++) {
+        fclose(runs[e].actions);
+    }
+    for (int i = 0; i < num_lines; i++) {
+        ck_free(lines[i]);
+    }
+    ck_free(lines);
+    return all_match ? 0 : 1;
+}
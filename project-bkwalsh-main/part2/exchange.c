@@ -17,17 +17,33 @@
 #include <stdio.h>
 
 #include "order.h"
+#include "order_pool.h"
+#include "symbols.h"
 #include "book.h"
 #include "action_report.h"
+#include "action_sink.h"
+#include "latency.h"
+#include "trace.h"
 #include "util.h"
 #include "exchange.h"
 
 struct exchange {
-  char *ticker;
+  char *ticker;         // interned
+  int symbol;           // interned id of ticker
   book_t *buy;
   book_t *sell;  
+  order_pool_t *pool;   // space for this exchange's orders
+  bool owns_pool;       // false if the pool is shared with other exchanges
+  action_sink_t sink;   // for send_order; on_action is NULL if none
+  latency_stats_t *latency;     // where to time orders, NULL if not timed
+  int untimed;                  // orders left before the next timed one
 };
 
+static void match_order(exchange_t *exchange, order_msg_t *msg, int time,
+                        action_sink_t *sink);
+static enum latency_path route_order(exchange_t *exchange, order_msg_t *msg,
+                                     int time, action_sink_t *sink);
+
 /* 
  * mk_exchange: make an exchange for the specified ticker symbol
  *
@@ -36,14 +52,83 @@ struct exchange {
  * Returns: an exchange
  */
 exchange_t *mk_exchange(char *ticker) {
+    return mk_exchange_book(ticker, default_book_ops());
+}
+
+/* 
+ * mk_exchange_book: make an exchange for the specified ticker symbol
+ *   whose books use a given representation
+ *
+ * ticker: the ticker symbol for the stock
+ * ops: the book representation
+ *
+ * Returns: an exchange
+ */
+exchange_t *mk_exchange_book(char *ticker, const book_ops_t *ops) {
+    exchange_t *out = mk_exchange_in_book(intern_symbol(ticker), 
+                                          mk_order_pool(), ops);
+    out->owns_pool = true;
+    return out;
+}
+
+/* 
+ * mk_exchange_sink: make an exchange for the specified ticker symbol
+ *   that delivers the actions for orders sent with send_order to a sink
+ *
+ * ticker: the ticker symbol for the stock
+ * sink: the sink, copied into the exchange
+ *
+ * Returns: an exchange
+ */
+exchange_t *mk_exchange_sink(char *ticker, action_sink_t *sink) {
+    assert(sink != NULL && sink->on_action != NULL);
+    exchange_t *out = mk_exchange(ticker);
+    out->sink = *sink;
+    return out;
+}
+
+/* 
+ * mk_exchange_in: make an exchange for an interned ticker that takes its
+ *   orders from a shared pool
+ *
+ * symbol: the interned id of the ticker symbol
+ * pool: the pool
+ *
+ * Returns: an exchange
+ */
+exchange_t *mk_exchange_in(int symbol, order_pool_t *pool) {
+    return mk_exchange_in_book(symbol, pool, default_book_ops());
+}
+
+/* 
+ * mk_exchange_in_book: make an exchange for an interned ticker that takes
+ *   its orders from a shared pool, with books that use a given
+ *   representation
+ *
+ * symbol: the interned id of the ticker symbol
+ * pool: the pool
+ * ops: the book representation
+ *
+ * Returns: an exchange
+ */
+exchange_t *mk_exchange_in_book(int symbol, order_pool_t *pool,
+                                const book_ops_t *ops) {
     exchange_t *out = (exchange_t*)malloc(sizeof(exchange_t));
     if (out == NULL) {
         fprintf(stderr, "exchange_t: Unable to allocate\n");
         exit(1);
     }
-    out->buy = bookmaker(BUY_BOOK);
-    out->sell = bookmaker(SELL_BOOK);  
-    out->ticker = ticker;
+    out->buy = mk_book(ops, BUY_BOOK);
+    out->sell = mk_book(ops, SELL_BOOK);
+    out->pool = pool;
+    out->owns_pool = false;
+    out->sink.on_action = NULL;
+    out->sink.ctx = NULL;
+    out->latency = NULL;
+    out->untimed = 0;
+    out->symbol = symbol;
+    out->ticker = symbol_name(symbol);
+    TRACE_EXCHANGE(TRACE_EXCHANGE_MADE, symbol);
     return out;
 }
 
@@ -54,8 +139,12 @@ exchange_t *mk_exchange(char *ticker) {
  * exchange: an exchange
  */
 void free_exchange(exchange_t *exchange) {
+    TRACE_EXCHANGE(TRACE_EXCHANGE_FREED, exchange->symbol);
     free_book_lst (exchange->buy);
     free_book_lst (exchange->sell);
+    if (exchange->owns_pool) {
+        free_order_pool (exchange->pool);
+    }
     free (exchange);
 }
 
@@ -82,23 +171,34 @@ bool check_transaction(order_t *pend_order, order_t *incoming_order){
     }
 }
 
-/* book_and_ar: Adds an order to its respective book, and adds the action
- * of booking to the action report. Used when no matches are suitable.
- * ar: action report
+/*
+ * add_path: the latency path for an add that executed against a number
+ *   of price levels
+ */
+static enum latency_path add_path(int levels) {
+    if (levels >= 4) {
+        return LATENCY_MATCH_4_PLUS;
+    }
+    return (enum latency_path) (LATENCY_BOOK + levels);
+}
+
+/* book_and_emit: Adds an order to its respective book, and tells the
+ * sink about the booking. Used when no matches are suitable.
+ * sink: where the booking action goes
  * order: desired order to add
  * exchange: exchange to add the order to
- * returns: modified action report (books are also modified by this function)
  */
-action_report_t *book_and_ar(action_report_t *ar, order_t *order, 
+void book_and_emit(action_sink_t *sink, order_t *order, 
     exchange_t *exchange){
     if (is_buy_order(order)){
-        add_action(ar,BOOKED_BUY,order->oref,order->price, order->shares);
+        sink->on_action(sink->ctx,order->time,BOOKED_BUY,order->oref,
+            order->price, order->shares);
         insert(exchange->buy, order);
     } else {
-        add_action(ar,BOOKED_SELL,order->oref,order->price, order->shares);
+        sink->on_action(sink->ctx,order->time,BOOKED_SELL,order->oref,
+            order->price, order->shares);
         insert(exchange->sell, order);
     }
-    return ar;    
 }
 
 
@@ -111,29 +211,253 @@ action_report_t *book_and_ar(action_report_t *ar, order_t *order,
  * ord_str: a string describing the order (in the expected format)
  * time: the time the order was placed.
  * 
- * Returns: An action report detailing what actions took place if any
+ * Returns: An action report detailing what actions took place if any. A line
+ *  that does not parse is reported on stderr and gets an empty report
  */
 action_report_t  *process_order(exchange_t *exchange, char *ord_str, int time){
+    assert(exchange != NULL);
+    return process_order_into(exchange, ord_str, time, 
+                              mk_action_report(exchange->ticker));
+}
+
+/* 
+ * process_order_into: process an order, recording the actions in a
+ *   report supplied by the caller
+ *
+ * exchange: an exchange
+ * ord_str: a string describing the order (in the expected format)
+ * time: the time the order was placed.
+ * out: the report to fill. It is reset first.
+ * 
+ * Returns: out. A line that does not parse is reported on stderr and
+ *  leaves out empty
+ */
+action_report_t *process_order_into(exchange_t *exchange, char *ord_str, 
+                                    int time, action_report_t *out) {
+    assert(exchange != NULL);
+    assert(ord_str != NULL);
+    order_msg_t msg;
+    enum parse_status status = parse_order_line(ord_str, &msg);
+    if (status != PARSE_OK) {
+        fprintf(stderr, "process_order: %s: %s\n", parse_status_str(status),
+                ord_str);
+        reset_action_report(out, exchange->ticker);
+        return out;
+    }
+    return process_order_msg_into(exchange, &msg, time, out);
+}
+
+/*
+ * check_msg: applies the checks parse_order makes on the fields of an
+ *  order that did not come from a line
+ *
+ * Returns: PARSE_OK or the status for the first bad field
+ */
+static enum parse_status check_msg(order_msg_t *msg) {
+    if (msg->symbol < 0 || msg->symbol >= num_symbols()) {
+        return PARSE_BAD_TICKER;
+    }
+    if (msg->type != 'A' && msg->type != 'C') {
+        return PARSE_BAD_TYPE;
+    }
+    if (msg->book != 'B' && msg->book != 'S') {
+        return PARSE_BAD_BOOK;
+    }
+    if (msg->shares <= 0) {
+        return PARSE_BAD_SHARES;
+    }
+    if (msg->price < 0) {
+        return PARSE_BAD_PRICE;
+    }
+    if (msg->oref < 0) {
+        return PARSE_BAD_OREF;
+    }
+    return PARSE_OK;
+}
+
+/*
+ * process_order_fields: process an order for the exchange's ticker
+ *   given its fields, without building an order line
+ *
+ * exchange: an exchange
+ * venue, type, book, shares, price, oref: the fields of the order
+ * time: the time the order was placed.
+ *
+ * Returns: An action report detailing what actions took place if any
+ */
+action_report_t *process_order_fields(exchange_t *exchange, char venue, 
+                                      char type, char book, int shares, 
+                                      long long price, long long oref, 
+                                      int time) {
+    order_msg_t msg = {
+        .price = price,
+        .oref = oref,
+        .shares = shares,
+        .symbol = exchange->symbol,
+        .venue = venue,
+        .type = type,
+        .book = book,
+    };
+    return process_order_msg(exchange, &msg, time);
+}
+
+/*
+ * process_order_msg: process an order that has already been parsed
+ *
+ * exchange: an exchange
+ * msg: the fields of the order
+ * time: the time the order was placed.
+ *
+ * Returns: An action report detailing what actions took place if any
+ */
+action_report_t *process_order_msg(exchange_t *exchange, order_msg_t *msg, 
+                                   int time) {
+    assert(exchange != NULL);
+    return process_order_msg_into(exchange, msg, time,
+                                  mk_action_report(exchange->ticker));
+}
+
+/*
+ * process_order_msg_into: process an order that has already been
+ *   parsed, recording the actions in a report supplied by the caller
+ *
+ * exchange: an exchange
+ * msg: the fields of the order
+ * time: the time the order was placed.
+ * out: the report to fill. It is reset first.
+ *
+ * Returns: out. An order with bad fields is reported on stderr and
+ *  leaves out empty
+ */
+action_report_t *process_order_msg_into(exchange_t *exchange, 
+                                        order_msg_t *msg, int time,
+                                        action_report_t *out) {
+    assert(exchange != NULL);
+    assert(out != NULL);
+    reset_action_report(out, exchange->ticker);
+    action_sink_t sink = report_sink(out);
+    match_order(exchange, msg, time, &sink);
+    return out;
+}
+
+/*
+ * send_order: process an order, delivering the actions to the sink the
+ *   exchange was made with
+ *
+ * exchange: an exchange made by mk_exchange_sink
+ * ord_str: a string describing the order (in the expected format)
+ * time: the time the order was placed.
+ */
+void send_order(exchange_t *exchange, char *ord_str, int time) {
     assert(exchange != NULL);
     assert(ord_str != NULL);
-    action_report_t *out = mk_action_report(exchange->ticker);
-    order_t *order = mk_order_from_line(ord_str,time);
+    order_msg_t msg;
+    enum parse_status status = parse_order_line(ord_str, &msg);
+    if (status != PARSE_OK) {
+        fprintf(stderr, "send_order: %s: %s\n", parse_status_str(status),
+                ord_str);
+        return;
+    }
+    send_order_msg(exchange, &msg, time);
+}
+
+/*
+ * send_order_msg: process an order that has already been parsed,
+ *   delivering the actions to the sink the exchange was made with
+ *
+ * exchange: an exchange made by mk_exchange_sink
+ * msg: the fields of the order
+ * time: the time the order was placed.
+ */
+void send_order_msg(exchange_t *exchange, order_msg_t *msg, int time) {
+    assert(exchange != NULL);
+    assert(exchange->sink.on_action != NULL);
+    match_order(exchange, msg, time, &exchange->sink);
+}
+
+/*
+ * exchange_track_latency: time the orders this exchange processes from
+ *   now on
+ *
+ * exchange: an exchange
+ * stats: the histograms to record into, or NULL to stop timing
+ */
+void exchange_track_latency(exchange_t *exchange, latency_stats_t *stats) {
+    exchange->latency = stats;
+    exchange->untimed = 0;
+}
+
+/*
+ * match_order: process an order, telling the sink about each action as
+ *   it is taken, and time it if the exchange is tracking latency and the
+ *   order is due to be sampled. Every way of sending an order to an
+ *   exchange ends up here.
+ *
+ * exchange: an exchange
+ * msg: the fields of the order
+ * time: the time the order was placed.
+ * sink: where the actions go
+ */
+static void match_order(exchange_t *exchange, order_msg_t *msg, int time,
+                        action_sink_t *sink) {
+    if (exchange->latency == NULL || exchange->untimed-- > 0) {
+        route_order(exchange, msg, time, sink);
+        return;
+    }
+    exchange->untimed = latency_sample_every(exchange->latency) - 1;
+    uint64_t start = latency_now();
+    enum latency_path path = route_order(exchange, msg, time, sink);
+    uint64_t end = latency_now();
+    if (path != NUM_LATENCY_PATHS) {
+        latency_record(exchange->latency, path, end - start);
+    }
+}
+
+/*
+ * route_order: the work of match_order
+ *
+ * An order with bad fields is reported on stderr and has no actions.
+ *
+ * Returns: the path the order took, or NUM_LATENCY_PATHS if it had bad
+ *   fields
+ */
+static enum latency_path route_order(exchange_t *exchange, order_msg_t *msg,
+                                     int time, action_sink_t *sink) {
+    assert(msg != NULL);
+    enum parse_status status = check_msg(msg);
+    if (status != PARSE_OK) {
+        fprintf(stderr, "process_order_msg: %s: oref %lld\n", 
+                parse_status_str(status), msg->oref);
+        return NUM_LATENCY_PATHS;
+    }
+    if (msg->symbol != exchange->symbol) {
+        fprintf(stderr, "process_order_msg: order for %s sent to %s: "
+                "oref %lld\n", symbol_name(msg->symbol), exchange->ticker,
+                msg->oref);
+        return NUM_LATENCY_PATHS;
+    }
+    order_t *order = mk_order_from_msg_in(exchange->pool, msg, time);
     order_t *cancel_var = NULL;
     bool is_buy = is_buy_order(order);
     bool sv=false;
+    enum latency_path path = LATENCY_CANCEL_MISS;
+    int levels = 0;             // price levels executed against
+    long long level_price = -1;
     if (is_c_buy_order (order)) {
        compute_cancel(exchange->buy, order, &cancel_var, &sv);
         if (cancel_var != NULL){
-            add_action(out,CANCEL_BUY,cancel_var->oref,cancel_var->price,
-                cancel_var->shares);
+            sink->on_action(sink->ctx,time,CANCEL_BUY,cancel_var->oref,
+                cancel_var->price,cancel_var->shares);
             free_order(cancel_var);
+            path = LATENCY_CANCEL_HIT;
         }
     } else if (is_c_sell_order (order)) {
         compute_cancel(exchange->sell, order, &cancel_var, &sv);
         if (cancel_var != NULL){
-            add_action(out,CANCEL_SELL,cancel_var->oref,cancel_var->price,
-                cancel_var->shares);
+            sink->on_action(sink->ctx,time,CANCEL_SELL,cancel_var->oref,
+                cancel_var->price,cancel_var->shares);
             free_order(cancel_var);
+            path = LATENCY_CANCEL_HIT;
         }
     } else {
         while (true) {
@@ -144,31 +468,36 @@ action_report_t  *process_order(exchange_t *exchange, char *ord_str, int time){
                 best_fit=best_order(exchange->buy);
             }
             if (best_fit==NULL) {
-                return book_and_ar(out,order,exchange);
+                book_and_emit(sink,order,exchange);
+                return add_path(levels);
             } else {
                 bool pendshares=true;
                 bool rm_pend=false;
                 if (check_transaction(best_fit, order)){
-                    order_t *transaction=update_order_shares(best_fit, order,
+                    if (best_fit->price != level_price) {
+                        level_price = best_fit->price;
+                        levels++;
+                    }
+                    int filled=update_order_shares(best_fit, order,
                         &pendshares, &rm_pend);
-                    add_action(out,EXECUTE,best_fit->oref,best_fit->price,
-                        transaction->shares);               
+                    sink->on_action(sink->ctx,time,EXECUTE,best_fit->oref,
+                        best_fit->price,filled);
                     if(rm_pend) {
                         if (is_buy) {                                                    
-                            rm_val(exchange->sell,0);
+                            rm_val(exchange->sell, best_fit);
                             free_order(best_fit);
                         } else {                                                        
-                            rm_val(exchange->buy,0);    
+                            rm_val(exchange->buy, best_fit);
                             free_order(best_fit);                    
                         }
                     }
-                    free_order(transaction);
                     if(!pendshares){
                         free_order(order);
-                        return out;
+                        return add_path(levels);
                     }
                 } else {
-                    return book_and_ar(out,order,exchange);
+                    book_and_emit(sink,order,exchange);
+                    return add_path(levels);
                 }
             } 
         }
@@ -176,7 +505,19 @@ action_report_t  *process_order(exchange_t *exchange, char *ord_str, int time){
     if (!sv){
         free_order(order);
     }
-    return out;
+    return path;
+}
+
+
+/*
+ * exchange_pool_stats: get the counters for the exchange's order pool
+ *
+ * exchange: an exchange
+ * hits: out parameter, orders served from the pool's free list
+ * misses: out parameter, orders that needed the pool to grow first
+ */
+void exchange_pool_stats(exchange_t *exchange, long *hits, long *misses) {
+    order_pool_stats(exchange->pool, hits, misses);
 }
 
 
@@ -12,6 +12,21 @@
 /* The type for an exchange.  This type is opaque */
 typedef struct exchange exchange_t;
 
+/* Parsed order fields, defined in order.h */
+struct order_msg;
+
+/* Order pool, defined in order_pool.h */
+struct order_pool;
+
+/* Action sink, defined in action_sink.h */
+struct action_sink;
+
+/* Latency histograms, defined in latency.h */
+struct latency_stats;
+
+/* Book representation, see book.h */
+struct book_ops;
+
 /* 
  * mk_exchange: make an exchange for the specified ticker symbol
  *
@@ -22,6 +37,59 @@ typedef struct exchange exchange_t;
 exchange_t *mk_exchange(char *ticker);
 
 
+/* 
+ * mk_exchange_sink: make an exchange for the specified ticker symbol
+ *   that delivers the actions for orders sent with send_order to a sink
+ *   as they happen. process_order and friends still fill reports.
+ *
+ * ticker: the ticker symbol for the stock
+ * sink: the sink (see action_sink.h), copied into the exchange
+ *
+ * Returns: an exchange
+ */
+exchange_t *mk_exchange_sink(char *ticker, struct action_sink *sink);
+
+
+/* 
+ * mk_exchange_in: make an exchange for an interned ticker that takes its
+ *   orders from a pool shared with other exchanges. Does not touch the
+ *   symbol table's index, so it may run on any thread.
+ *
+ * symbol: the interned id of the ticker symbol (see symbols.h)
+ * pool: the pool. It is not freed with the exchange.
+ *
+ * Returns: an exchange
+ */
+exchange_t *mk_exchange_in(int symbol, struct order_pool *pool);
+
+
+/* 
+ * mk_exchange_book: make an exchange for the specified ticker symbol
+ *   whose books use a given representation. The other constructors use
+ *   the default one (default_book_ops in book.h).
+ *
+ * ticker: the ticker symbol for the stock
+ * ops: the book representation, e.g. find_book_ops("heap")
+ *
+ * Returns: an exchange
+ */
+exchange_t *mk_exchange_book(char *ticker, const struct book_ops *ops);
+
+
+/* 
+ * mk_exchange_in_book: mk_exchange_in, with books that use a given
+ *   representation
+ *
+ * symbol: the interned id of the ticker symbol (see symbols.h)
+ * pool: the pool. It is not freed with the exchange.
+ * ops: the book representation
+ *
+ * Returns: an exchange
+ */
+exchange_t *mk_exchange_in_book(int symbol, struct order_pool *pool,
+                                const struct book_ops *ops);
+
+
 /*
  * free_exchange: free the space associated with the
  *   exchange
@@ -42,6 +110,112 @@ void free_exchange(exchange_t *exc);
 action_report_t  *process_order(exchange_t *exchange, char *ord_str, int time);
 
 
+/* 
+ * process_order_into: like process_order, but records the actions in a
+ *   report supplied by the caller, which is reset first. Reusing one
+ *   report for every order avoids allocating a report per order.
+ *
+ * exc: an exchange
+ * ord_str: a string describing the order (in the expected format)
+ * time: the time the order was placed.
+ * out: the report to fill
+ *
+ * Returns: out
+ */
+action_report_t *process_order_into(exchange_t *exchange, char *ord_str, 
+                                    int time, action_report_t *out);
+
+
+/*
+ * process_order_msg: process an order that has already been parsed.
+ *   Shares the matching code with process_order, so the same order
+ *   gives the same action report either way. An order for some other
+ *   ticker is reported on stderr and gets an empty report.
+ *
+ * exc: an exchange
+ * msg: the fields of the order (see order.h)
+ * time: the time the order was placed.
+ */
+action_report_t *process_order_msg(exchange_t *exchange, 
+                                   struct order_msg *msg, int time);
+
+
+/*
+ * process_order_msg_into: like process_order_msg, but records the
+ *   actions in a report supplied by the caller, which is reset first
+ *
+ * exc: an exchange
+ * msg: the fields of the order (see order.h)
+ * time: the time the order was placed.
+ * out: the report to fill
+ *
+ * Returns: out
+ */
+action_report_t *process_order_msg_into(exchange_t *exchange, 
+                                        struct order_msg *msg, int time,
+                                        action_report_t *out);
+
+
+/*
+ * process_order_fields: process an order for the exchange's ticker
+ *   given its fields, without building an order line
+ *
+ * exc: an exchange
+ * venue, type, book, shares, price, oref: the fields of the order, as
+ *   in the order line
+ * time: the time the order was placed.
+ */
+action_report_t *process_order_fields(exchange_t *exchange, char venue, 
+                                      char type, char book, int shares, 
+                                      long long price, long long oref, 
+                                      int time);
+
+
+/*
+ * send_order: process an order, delivering each action to the exchange's
+ *   sink while the order is matched. No report is made. A line that does
+ *   not parse is reported on stderr.
+ *
+ * exc: an exchange made by mk_exchange_sink
+ * ord_str: a string describing the order (in the expected format)
+ * time: the time the order was placed.
+ */
+void send_order(exchange_t *exchange, char *ord_str, int time);
+
+
+/*
+ * send_order_msg: like send_order, for an order that has already been
+ *   parsed
+ *
+ * exc: an exchange made by mk_exchange_sink
+ * msg: the fields of the order (see order.h)
+ * time: the time the order was placed.
+ */
+void send_order_msg(exchange_t *exchange, struct order_msg *msg, int time);
+
+
+/*
+ * exchange_pool_stats: get the counters for the exchange's order pool
+ *
+ * exc: an exchange
+ * hits: out parameter, orders served from the pool's free list
+ * misses: out parameter, orders that needed the pool to grow first
+ */
+void exchange_pool_stats(exchange_t *exc, long *hits, long *misses);
+
+
+/*
+ * exchange_track_latency: time the orders the exchange processes from
+ *   now on, as often as the stats sample, recording each time under the
+ *   path the order took (see latency.h)
+ *
+ * exc: an exchange
+ * stats: the histograms to record into, or NULL to stop timing. Only
+ *   the thread that processes the exchange's orders may record into it.
+ */
+void exchange_track_latency(exchange_t *exc, struct latency_stats *stats);
+
+
 /*
  * print_exchange: print the contents of the exchange
  *
@@ -0,0 +1,417 @@
+/*
+ * CS 152, Spring 2022
+ * Synthetic Order Generator
+ *
+ * Writes an order file and a times file in the format of the files in
+ * tests/, with as many orders as wanted, so the books can be run at
+ * realistic depths:
+ *
+ *   ./genorders -n 10000000 -t 50 -s 7 big_orders.csv big_times.csv
+ *   ./simulate -m big_orders.csv big_actions.csv
+ *
+ * The flow is made up as follows. The same seed always gives the same
+ * files.
+ *
+ *   arrivals   a Poisson process: gaps between orders are exponential
+ *              with mean 1/rate. Times are in microseconds and must
+ *              fit in an int, so the orders can cover at most about
+ *              35 minutes; -n over -r is checked before anything is
+ *              written.
+ *   price      each ticker's mid price takes a random walk, one normal
+ *              step per order for that ticker, rounded to the tick
+ *   spread     adds rest an exponentially distributed number of ticks
+ *              away from the mid on their own side; a share of them are
+ *              marketable and cross the mid by the same kind of amount
+ *   shares     mostly round lots of 100, with some odd lots
+ *   cancels    a share of the orders cancel a random resting add of the
+ *              same ticker; some of those cancel only part of it
+ *
+ * Adds get increasing orefs starting at 1. The generator does not match
+ * orders, so some cancels will be for orders that have since executed,
+ * which the exchange has to handle anyway.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "util.h"
+
+#define DEFAULT_ORDERS 1000000
+#define MAX_ORDERS 1000000000L
+#define DEFAULT_RATE 100000.0   // orders per second
+#define DEFAULT_PRICE 550000
+#define DEFAULT_TICK 100
+#define DEFAULT_WALK 0.1        // standard deviation of a step, in ticks
+#define DEFAULT_SPREAD 8.0      // mean distance from the mid, in ticks
+#define DEFAULT_CROSS 0.05
+#define DEFAULT_CANCEL 0.3
+#define DEFAULT_PARTIAL 0.2
+#define ODD_LOT_PCT 10
+#define MEAN_LOTS 3.0
+#define MAX_LIVE 65536          // resting adds remembered per ticker
+#define TICKER_LEN 4
+#define MAX_VENUES 26
+#define OUT_BUFFER (1 << 20)
+#define PI 3.14159265358979323846
+#define CLOCK_SIGMAS 10.0       // room left for the last time to run late
+
+/* an add that a later cancel may refer to */
+typedef struct live_order {
+    long long oref;
+    long long price;
+    int shares;
+    char book;
+    char venue;
+} live_order_t;
+
+typedef struct ticker {
+    char name[TICKER_LEN + 1];
+    double mid;                 // in ticks
+    live_order_t *live;         // up to MAX_LIVE, in no particular order
+    int num_live;
+} ticker_t;
+
+typedef struct config {
+    long num_orders;
+    unsigned long long seed;
+    double rate;
+    long long price;
+    long long tick;
+    double walk;
+    double spread;
+    double cross;
+    double cancel;
+    double partial;
+    int num_tickers;
+    int num_venues;
+} config_t;
+
+/* xorshift64* state */
+static unsigned long long rng_state;
+
+/*
+ * seed_rand: start the generator from a seed. The seed is mixed first
+ *   (splitmix64) so nearby seeds give unrelated streams.
+ */
+static void seed_rand(unsigned long long seed) {
+    unsigned long long z = seed + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    rng_state = (z ^ (z >> 31)) | 1;
+}
+
+/*
+ * next_rand: the next 64 random bits
+ */
+static unsigned long long next_rand() {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545f4914f6cdd1dULL;
+}
+
+/*
+ * uniform: a random number in (0, 1)
+ */
+static double uniform() {
+    return ((next_rand() >> 11) + 0.5) / 9007199254740992.0;
+}
+
+/*
+ * exponential: a random number from the exponential distribution
+ */
+static double exponential(double mean) {
+    return -mean * log(uniform());
+}
+
+/*
+ * normal: a random number from the standard normal distribution
+ */
+static double normal() {
+    return sqrt(-2 * log(uniform())) * cos(2 * PI * uniform());
+}
+
+/*
+ * pick: a random number from 0 to n - 1
+ */
+static long pick(long n) {
+    return next_rand() % n;
+}
+
+/*
+ * name_ticker: make up the name of the i-th ticker: AAAA, AAAB, ...
+ */
+static void name_ticker(char *name, int i) {
+    for (int k = TICKER_LEN - 1; k >= 0; k--) {
+        name[k] = 'A' + i % 26;
+        i /= 26;
+    }
+    name[TICKER_LEN] = '\0';
+}
+
+/*
+ * remember: note an add so a later cancel can refer to it. Once the
+ *   ticker has MAX_LIVE adds, a random one is forgotten to make room.
+ */
+static void remember(ticker_t *t, live_order_t *o) {
+    if (t->num_live < MAX_LIVE) {
+        t->live[t->num_live++] = *o;
+    } else {
+        t->live[pick(MAX_LIVE)] = *o;
+    }
+}
+
+/*
+ * write_add: make up an add for a ticker and write it
+ */
+static void write_add(FILE *out, config_t *cfg, ticker_t *t, char venue,
+                      long long oref) {
+    live_order_t o;
+    o.oref = oref;
+    o.venue = venue;
+    o.book = (next_rand() & 1) ? 'B' : 'S';
+    if ((long) pick(100) < ODD_LOT_PCT) {
+        o.shares = 1 + pick(99);
+    } else {
+        o.shares = 100 * (1 + (int) exponential(MEAN_LOTS));
+    }
+    // ticks away from the mid, towards the order's own side unless the
+    // order is marketable
+    long long away = (long long) exponential(cfg->spread);
+    if (uniform() < cfg->cross) {
+        away = -1 - away;
+    }
+    long long ticks = (long long) llround(t->mid);
+    ticks += o.book == 'B' ? -away : away;
+    if (ticks < 1) {
+        ticks = 1;
+    }
+    o.price = ticks * cfg->tick;
+    fprintf(out, "%c,%s,A,%c,%d,%lld,%lld\n", venue, t->name, o.book,
+            o.shares, o.price, o.oref);
+    remember(t, &o);
+}
+
+/*
+ * write_cancel: cancel all or part of a random remembered add for a
+ *   ticker and write the cancel
+ *
+ * Returns: false if the ticker has nothing to cancel
+ */
+static bool write_cancel(FILE *out, config_t *cfg, ticker_t *t) {
+    if (t->num_live == 0) {
+        return false;
+    }
+    int i = pick(t->num_live);
+    live_order_t *o = &t->live[i];
+    int shares = o->shares;
+    bool partial = o->shares > 1 && uniform() < cfg->partial;
+    if (partial) {
+        shares = 1 + pick(o->shares - 1);
+    }
+    fprintf(out, "%c,%s,C,%c,%d,%lld,%lld\n", o->venue, t->name, o->book,
+            shares, o->price, o->oref);
+    if (partial) {
+        o->shares -= shares;
+    } else {
+        t->live[i] = t->live[--t->num_live];
+    }
+    return true;
+}
+
+/*
+ * generate: write the orders and their times
+ */
+static void generate(config_t *cfg, FILE *orders, FILE *times) {
+    seed_rand(cfg->seed);
+    ticker_t *tickers = (ticker_t *) ck_malloc(sizeof(ticker_t) *
+                                               cfg->num_tickers, "generate");
+    for (int i = 0; i < cfg->num_tickers; i++) {
+        name_ticker(tickers[i].name, i);
+        tickers[i].mid = (double) cfg->price / cfg->tick;
+        tickers[i].live = (live_order_t *)
+            ck_malloc(sizeof(live_order_t) * MAX_LIVE, "generate");
+        tickers[i].num_live = 0;
+    }
+
+    fprintf(times, "%ld\n", cfg->num_orders);
+    double clock = 0;           // microseconds
+    long long next_oref = 1;
+    for (long n = 0; n < cfg->num_orders; n++) {
+        clock += exponential(1e6 / cfg->rate);
+        if (clock > INT_MAX) {
+            // times_fit leaves CLOCK_SIGMAS of room, so this is not
+            // expected; stop the clock rather than leave half a file
+            clock = INT_MAX;
+        }
+        fprintf(times, "%d\n", (int) clock);
+
+        ticker_t *t = &tickers[pick(cfg->num_tickers)];
+        t->mid += cfg->walk * normal();
+        if (t->mid < 1) {
+            t->mid = 1;
+        }
+        if (uniform() < cfg->cancel && write_cancel(orders, cfg, t)) {
+            continue;
+        }
+        char venue = 'A' + (8 + pick(cfg->num_venues)) % 26;  // from 'I'
+        write_add(orders, cfg, t, venue, next_oref++);
+    }
+
+    for (int i = 0; i < cfg->num_tickers; i++) {
+        ck_free(tickers[i].live);
+    }
+    ck_free(tickers);
+}
+
+/*
+ * times_fit: will the times of every order fit in an int? The last time
+ *   is a sum of num_orders exponential gaps, so it has to be within
+ *   INT_MAX with CLOCK_SIGMAS standard deviations to spare.
+ */
+static bool times_fit(long num_orders, double rate) {
+    double mean_gap = 1e6 / rate;
+    return num_orders * mean_gap + CLOCK_SIGMAS * sqrt(num_orders) * mean_gap
+        <= INT_MAX;
+}
+
+/*
+ * usage: print the options and exit
+ */
+static void usage() {
+    fprintf(stderr, "usage: genorders [options] <orders file> "
+            "<times file>\n");
+    fprintf(stderr, "  -n orders       number of orders (default %d, "
+            "at most %ld)\n", DEFAULT_ORDERS, MAX_ORDERS);
+    fprintf(stderr, "  -s seed         random seed (default 1)\n");
+    fprintf(stderr, "  -r rate         mean orders per second (default "
+            "%.0f); the times\n                  must fit in an int, so "
+            "orders / rate is at most\n                  about %.0f "
+            "seconds\n", DEFAULT_RATE, INT_MAX / 1e6);
+    fprintf(stderr, "  -p price        starting mid price (default %d)\n",
+            DEFAULT_PRICE);
+    fprintf(stderr, "  -k tick         price tick (default %d)\n",
+            DEFAULT_TICK);
+    fprintf(stderr, "  -w ticks        random walk step std dev (default "
+            "%.1f)\n", DEFAULT_WALK);
+    fprintf(stderr, "  -d ticks        mean distance from the mid "
+            "(default %.1f)\n", DEFAULT_SPREAD);
+    fprintf(stderr, "  -x fraction     marketable share of adds (default "
+            "%.2f)\n", DEFAULT_CROSS);
+    fprintf(stderr, "  -c fraction     cancel share of orders (default "
+            "%.2f)\n", DEFAULT_CANCEL);
+    fprintf(stderr, "  -P fraction     partial share of cancels (default "
+            "%.2f)\n", DEFAULT_PARTIAL);
+    fprintf(stderr, "  -t tickers      number of tickers (default 1)\n");
+    fprintf(stderr, "  -v venues       number of venues (default 1, at "
+            "most %d)\n", MAX_VENUES);
+    exit(1);
+}
+
+/*
+ * fraction: read an option that must be between 0 and 1
+ */
+static double fraction(char *arg) {
+    double f = atof(arg);
+    if (f < 0 || f > 1) {
+        usage();
+    }
+    return f;
+}
+
+int main(int argc, char **argv) {
+    config_t cfg = {
+        .num_orders = DEFAULT_ORDERS,
+        .seed = 1,
+        .rate = DEFAULT_RATE,
+        .price = DEFAULT_PRICE,
+        .tick = DEFAULT_TICK,
+        .walk = DEFAULT_WALK,
+        .spread = DEFAULT_SPREAD,
+        .cross = DEFAULT_CROSS,
+        .cancel = DEFAULT_CANCEL,
+        .partial = DEFAULT_PARTIAL,
+        .num_tickers = 1,
+        .num_venues = 1,
+    };
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:r:p:k:w:d:x:c:P:t:v:")) != -1) {
+        switch (opt) {
+        case 'n':
+            cfg.num_orders = atol(optarg);
+            break;
+        case 's':
+            cfg.seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'r':
+            cfg.rate = atof(optarg);
+            break;
+        case 'p':
+            cfg.price = atoll(optarg);
+            break;
+        case 'k':
+            cfg.tick = atoll(optarg);
+            break;
+        case 'w':
+            cfg.walk = atof(optarg);
+            break;
+        case 'd':
+            cfg.spread = atof(optarg);
+            break;
+        case 'x':
+            cfg.cross = fraction(optarg);
+            break;
+        case 'c':
+            cfg.cancel = fraction(optarg);
+            break;
+        case 'P':
+            cfg.partial = fraction(optarg);
+            break;
+        case 't':
+            cfg.num_tickers = atoi(optarg);
+            break;
+        case 'v':
+            cfg.num_venues = atoi(optarg);
+            break;
+        default:
+            usage();
+        }
+    }
+    if (argc - optind != 2 || cfg.num_orders < 0 ||
+        cfg.num_orders > MAX_ORDERS || cfg.rate <= 0 || cfg.price <= 0 ||
+        cfg.tick <= 0 || cfg.walk < 0 || cfg.spread < 0 ||
+        cfg.num_tickers < 1 || cfg.num_venues < 1 ||
+        cfg.num_venues > MAX_VENUES) {
+        usage();
+    }
+    if (!times_fit(cfg.num_orders, cfg.rate)) {
+        fprintf(stderr, "genorders: %ld orders at %g a second need times "
+                "past %d microseconds; lower -n or raise -r\n",
+                cfg.num_orders, cfg.rate, INT_MAX);
+        exit(1);
+    }
+
+    FILE *orders = fopen(argv[optind], "w");
+    FILE *times = fopen(argv[optind + 1], "w");
+    if (orders == NULL || times == NULL) {
+        fprintf(stderr, "genorders: cannot write %s\n",
+                orders == NULL ? argv[optind] : argv[optind + 1]);
+        exit(1);
+    }
+    setvbuf(orders, NULL, _IOFBF, OUT_BUFFER);
+    setvbuf(times, NULL, _IOFBF, OUT_BUFFER);
+    generate(&cfg, orders, times);
+    if (fclose(orders) != 0 || fclose(times) != 0) {
+        fprintf(stderr, "genorders: write failed\n");
+        exit(1);
+    }
+    return 0;
+}
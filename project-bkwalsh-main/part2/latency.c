@@ -0,0 +1,287 @@
+/*
+ * CS 152, Spring 2022
+ * Latency Histograms
+ *
+ * A value v below SUB_BUCKETS has a bucket to itself. Above that, with
+ * e the position of its highest set bit, it goes in the bucket for e
+ * and its next SUB_BITS bits. Clock ticks become nanoseconds using the
+ * time stamp counter and CLOCK_MONOTONIC_RAW readings taken when the
+ * stats were made and again when they are read.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#include "latency.h"
+#include "util.h"
+
+#define SUB_BITS 4
+#define SUB_BUCKETS (1 << SUB_BITS)
+#define NUM_BUCKETS ((64 - SUB_BITS + 1) * SUB_BUCKETS)
+#define MIN_CALIBRATION_NS 10000000     // 10ms
+
+typedef struct histogram {
+    long count;
+    uint64_t max;
+    long buckets[NUM_BUCKETS];
+} histogram_t;
+
+struct latency_stats {
+    histogram_t paths[NUM_LATENCY_PATHS];
+    uint64_t start_ticks;       // clock readings when the stats were made,
+    uint64_t start_ns;          //   to turn ticks into nanoseconds
+    int sample_every;
+};
+
+static const char *path_names[] = {"book", "match_1", "match_2", "match_3",
+                                   "match_4_plus", "cancel_hit",
+                                   "cancel_miss"};
+
+/*
+ * raw_ns: read CLOCK_MONOTONIC_RAW in nanoseconds
+ */
+static uint64_t raw_ns() {
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC_RAW
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * latency_now: read the clock the histograms use
+ *
+ * Returns: the time in clock ticks
+ */
+uint64_t latency_now() {
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return raw_ns();
+#endif
+}
+
+/*
+ * mk_latency_stats: make an empty set of histograms, one per path
+ *
+ * sample_every: time one order in this many; 1 times every order
+ *
+ * Returns: the histograms
+ */
+latency_stats_t *mk_latency_stats(int sample_every) {
+    assert(sample_every >= 1);
+    latency_stats_t *stats = (latency_stats_t *)
+        ck_malloc(sizeof(latency_stats_t), "mk_latency_stats");
+    memset(stats->paths, 0, sizeof(stats->paths));
+    stats->sample_every = sample_every;
+    stats->start_ns = raw_ns();
+    stats->start_ticks = latency_now();
+    return stats;
+}
+
+/*
+ * latency_sample_every: how often orders are timed
+ *
+ * Returns: the sample_every the stats were made with
+ */
+int latency_sample_every(latency_stats_t *stats) {
+    return stats->sample_every;
+}
+
+/*
+ * free_latency_stats: free a set of histograms
+ */
+void free_latency_stats(latency_stats_t *stats) {
+    ck_free(stats);
+}
+
+/*
+ * bucket_of: the bucket a value goes in
+ */
+static int bucket_of(uint64_t v) {
+    if (v < SUB_BUCKETS) {
+        return v;
+    }
+    int e = 63 - __builtin_clzll(v);
+    int sub = (v >> (e - SUB_BITS)) & (SUB_BUCKETS - 1);
+    return (e - SUB_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+/*
+ * bucket_top: the largest value that goes in a bucket
+ */
+static uint64_t bucket_top(int bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    int e = bucket / SUB_BUCKETS + SUB_BITS - 1;
+    uint64_t sub = bucket % SUB_BUCKETS;
+    uint64_t bottom = ((uint64_t) SUB_BUCKETS + sub) << (e - SUB_BITS);
+    return bottom + (((uint64_t) 1 << (e - SUB_BITS)) - 1);
+}
+
+/*
+ * latency_record: add one order's time to the histogram for its path
+ *
+ * stats: the histograms
+ * path: the path the order took
+ * ticks: the time the order took, in clock ticks
+ */
+void latency_record(latency_stats_t *stats, enum latency_path path,
+                    uint64_t ticks) {
+    histogram_t *h = &stats->paths[path];
+    h->buckets[bucket_of(ticks)]++;
+    h->count++;
+    if (ticks > h->max) {
+        h->max = ticks;
+    }
+}
+
+/*
+ * latency_merge: add every time recorded in one set of histograms to
+ *   another
+ *
+ * into: the histograms to add to
+ * from: the histograms to add; unchanged
+ */
+void latency_merge(latency_stats_t *into, latency_stats_t *from) {
+    for (int p = 0; p < NUM_LATENCY_PATHS; p++) {
+        histogram_t *to = &into->paths[p];
+        histogram_t *h = &from->paths[p];
+        for (int b = 0; b < NUM_BUCKETS; b++) {
+            to->buckets[b] += h->buckets[b];
+        }
+        to->count += h->count;
+        if (h->max > to->max) {
+            to->max = h->max;
+        }
+    }
+}
+
+/*
+ * ns_per_tick: how many nanoseconds a clock tick lasts, measured
+ *   between when the stats were made and now. Waits if the stats are
+ *   too new for a good measurement.
+ */
+static double ns_per_tick(latency_stats_t *stats) {
+#ifdef HAVE_TSC
+    uint64_t ns, ticks;
+    do {
+        ns = raw_ns();
+        ticks = latency_now();
+    } while (ns - stats->start_ns < MIN_CALIBRATION_NS);
+    return (double) (ns - stats->start_ns) / (ticks - stats->start_ticks);
+#else
+    return 1.0;
+#endif
+}
+
+/*
+ * latency_count: the number of orders recorded for a path
+ */
+long latency_count(latency_stats_t *stats, enum latency_path path) {
+    assert(path < NUM_LATENCY_PATHS);
+    return stats->paths[path].count;
+}
+
+/*
+ * percentile_ticks: a percentile of a histogram, in clock ticks
+ */
+static uint64_t percentile_ticks(histogram_t *h, double percentile) {
+    if (h->count == 0) {
+        return 0;
+    }
+    long rank = (long) (percentile / 100 * h->count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    long seen = 0;
+    for (int b = 0; b < NUM_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= rank) {
+            uint64_t top = bucket_top(b);
+            return top < h->max ? top : h->max;
+        }
+    }
+    return h->max;
+}
+
+/*
+ * latency_percentile_ns: a percentile of the times recorded for a path
+ *
+ * stats: the histograms
+ * path: the path
+ * percentile: between 0 and 100, e.g. 99.9
+ *
+ * Returns: the percentile in nanoseconds, 0 if nothing was recorded
+ */
+double latency_percentile_ns(latency_stats_t *stats, enum latency_path path,
+                             double percentile) {
+    assert(path < NUM_LATENCY_PATHS);
+    assert(percentile >= 0 && percentile <= 100);
+    histogram_t *h = &stats->paths[path];
+    if (h->count == 0) {
+        return 0;
+    }
+    return percentile_ticks(h, percentile) * ns_per_tick(stats);
+}
+
+/*
+ * latency_max_ns: the longest time recorded for a path
+ *
+ * Returns: the time in nanoseconds, 0 if nothing was recorded
+ */
+double latency_max_ns(latency_stats_t *stats, enum latency_path path) {
+    assert(path < NUM_LATENCY_PATHS);
+    histogram_t *h = &stats->paths[path];
+    if (h->count == 0) {
+        return 0;
+    }
+    return h->max * ns_per_tick(stats);
+}
+
+/*
+ * print_latency_stats: write one CSV line per path that has any orders,
+ *   with how often orders were timed
+ *
+ * stats: the histograms
+ * fp: a file pointer
+ */
+void print_latency_stats(latency_stats_t *stats, FILE *fp) {
+    double scale = ns_per_tick(stats);
+    fprintf(fp, "path,timed,sample_every,p50_ns,p99_ns,p99.9_ns,max_ns\n");
+    for (int p = 0; p < NUM_LATENCY_PATHS; p++) {
+        histogram_t *h = &stats->paths[p];
+        if (h->count == 0) {
+            continue;
+        }
+        fprintf(fp, "%s,%ld,%d,%.0f,%.0f,%.0f,%.0f\n", path_names[p],
+                h->count, stats->sample_every,
+                percentile_ticks(h, 50) * scale,
+                percentile_ticks(h, 99) * scale,
+                percentile_ticks(h, 99.9) * scale, h->max * scale);
+    }
+}
+
+/*
+ * latency_path_str: the name of a path
+ *
+ * Returns: a constant string
+ */
+const char *latency_path_str(enum latency_path path) {
+    assert(path < NUM_LATENCY_PATHS);
+    return path_names[path];
+}
@@ -0,0 +1,137 @@
+/*
+ * CS 152, Spring 2022
+ * Latency Histogram Interface.
+ *
+ * Records how long each order takes inside an exchange, split by the
+ * path the order took. An exchange only times orders once it has been
+ * given a latency_stats_t (exchange_track_latency); until then the only
+ * cost is one test of a NULL pointer.
+ *
+ * Times are read from the CPU's time stamp counter where there is one
+ * and from CLOCK_MONOTONIC_RAW otherwise, and are converted to
+ * nanoseconds only when the results are read. Each path has an
+ * HDR-style histogram: 16 linear sub-buckets for every power of two, so
+ * a percentile is within 1/16 (6.25%) of the true value of the orders
+ * timed. The maximum is the exact maximum of the orders timed.
+ *
+ * Reading the clock twice is most of the cost of timing an order (about
+ * 45ns where the time stamp counter is virtualised, under 15ns where it
+ * is not), so the stats can time just one order in every few, and
+ * simulate -l does (LATENCY_SAMPLE_EVERY). Every statistic, the count
+ * and the maximum included, then covers only the orders that were
+ * timed: percentiles stay close as long as plenty of orders are timed,
+ * but the slowest order can be one that was not.
+ *
+ * A latency_stats_t is not locked, so only one thread may record into
+ * it. Give each thread its own and merge them with latency_merge.
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* The way an order went through the exchange. MATCH_N is an add that
+ * executed against N price levels before it was filled or booked. */
+enum latency_path {LATENCY_BOOK, LATENCY_MATCH_1, LATENCY_MATCH_2,
+                   LATENCY_MATCH_3, LATENCY_MATCH_4_PLUS, LATENCY_CANCEL_HIT,
+                   LATENCY_CANCEL_MISS, NUM_LATENCY_PATHS};
+
+/* Time one order in this many when no other rate is wanted; keeps the
+ * cost under 20ns per order even with a slow clock */
+#define LATENCY_SAMPLE_EVERY 8
+
+/* The type for a set of histograms. This type is opaque */
+typedef struct latency_stats latency_stats_t;
+
+/*
+ * mk_latency_stats: make an empty set of histograms, one per path
+ *
+ * sample_every: time one order in this many; 1 times every order
+ *
+ * Returns: the histograms
+ */
+latency_stats_t *mk_latency_stats(int sample_every);
+
+/*
+ * latency_sample_every: how often orders are timed
+ *
+ * Returns: the sample_every the stats were made with
+ */
+int latency_sample_every(latency_stats_t *stats);
+
+/*
+ * free_latency_stats: free a set of histograms
+ */
+void free_latency_stats(latency_stats_t *stats);
+
+/*
+ * latency_now: read the clock the histograms use
+ *
+ * Returns: the time in clock ticks
+ */
+uint64_t latency_now();
+
+/*
+ * latency_record: add one order's time to the histogram for its path
+ *
+ * stats: the histograms
+ * path: the path the order took
+ * ticks: the time the order took, in clock ticks
+ */
+void latency_record(latency_stats_t *stats, enum latency_path path,
+                    uint64_t ticks);
+
+/*
+ * latency_merge: add every time recorded in one set of histograms to
+ *   another
+ *
+ * into: the histograms to add to
+ * from: the histograms to add; unchanged
+ */
+void latency_merge(latency_stats_t *into, latency_stats_t *from);
+
+/*
+ * latency_count: the number of orders recorded for a path
+ */
+long latency_count(latency_stats_t *stats, enum latency_path path);
+
+/*
+ * latency_percentile_ns: a percentile of the times recorded for a path
+ *
+ * stats: the histograms
+ * path: the path
+ * percentile: between 0 and 100, e.g. 99.9
+ *
+ * Returns: the percentile in nanoseconds, 0 if nothing was recorded
+ */
+double latency_percentile_ns(latency_stats_t *stats, enum latency_path path,
+                             double percentile);
+
+/*
+ * latency_max_ns: the longest time recorded for a path
+ *
+ * Returns: the time in nanoseconds, 0 if nothing was recorded
+ */
+double latency_max_ns(latency_stats_t *stats, enum latency_path path);
+
+/*
+ * print_latency_stats: write one CSV line per path that has any orders:
+ *   path,timed,sample_every,p50_ns,p99_ns,p99.9_ns,max_ns
+ *   timed is the number of orders timed, one in every sample_every, and
+ *   the other columns are over those orders only
+ *
+ * stats: the histograms
+ * fp: a file pointer
+ */
+void print_latency_stats(latency_stats_t *stats, FILE *fp);
+
+/*
+ * latency_path_str: the name of a path
+ *
+ * Returns: a constant string
+ */
+const char *latency_path_str(enum latency_path path);
+
+#endif
@@ -0,0 +1,222 @@
+/*
+ * CS 152, Spring 2022
+ * Market
+ *
+ * Exchanges are kept in an array indexed by interned ticker id, so
+ * routing an order is one array load once its ticker has been parsed.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "order.h"
+#include "order_pool.h"
+#include "symbols.h"
+#include "action_report.h"
+#include "exchange.h"
+#include "latency.h"
+#include "market.h"
+#include "util.h"
+
+#define INIT_SLOTS 64
+
+struct market {
+    exchange_t **by_symbol;     // indexed by ticker id, NULL if no exchange
+    int num_slots;
+    int num_exchanges;
+    order_pool_t *pool;         // shared by every exchange
+    latency_stats_t *latency;   // given to every exchange, NULL if none
+};
+
+/*
+ * mk_market: make a market with no exchanges
+ *
+ * Returns: a market
+ */
+market_t *mk_market() {
+    market_t *market = (market_t *) ck_malloc(sizeof(market_t), "mk_market");
+    market->by_symbol = (exchange_t **) ck_malloc(sizeof(exchange_t *) * 
+                                                  INIT_SLOTS, "mk_market");
+    for (int i = 0; i < INIT_SLOTS; i++) {
+        market->by_symbol[i] = NULL;
+    }
+    market->num_slots = INIT_SLOTS;
+    market->num_exchanges = 0;
+    market->pool = mk_order_pool();
+    market->latency = NULL;
+    return market;
+}
+
+/*
+ * free_market: free a market along with all of its exchanges
+ *
+ * market: a market
+ */
+void free_market(market_t *market) {
+    for (int i = 0; i < market->num_slots; i++) {
+        if (market->by_symbol[i] != NULL) {
+            free_exchange(market->by_symbol[i]);
+        }
+    }
+    // the exchanges have given back all of their orders by now
+    free_order_pool(market->pool);
+    ck_free(market->by_symbol);
+    ck_free(market);
+}
+
+/*
+ * get_exchange: find the exchange for a ticker id, making it if needed
+ *
+ * market: a market
+ * symbol: interned ticker id
+ *
+ * Returns: the exchange
+ */
+static exchange_t *get_exchange(market_t *market, int symbol) {
+    assert(symbol >= 0);
+    if (symbol >= market->num_slots) {
+        int new_num_slots = market->num_slots;
+        while (symbol >= new_num_slots) {
+            new_num_slots *= 2;
+        }
+        market->by_symbol = (exchange_t **) 
+            ck_realloc(market->by_symbol, sizeof(exchange_t *) * 
+                       new_num_slots, "get_exchange");
+        for (int i = market->num_slots; i < new_num_slots; i++) {
+            market->by_symbol[i] = NULL;
+        }
+        market->num_slots = new_num_slots;
+    }
+    exchange_t *exchange = market->by_symbol[symbol];
+    if (exchange == NULL) {
+        exchange = mk_exchange_in(symbol, market->pool);
+        exchange_track_latency(exchange, market->latency);
+        market->by_symbol[symbol] = exchange;
+        market->num_exchanges++;
+    }
+    return exchange;
+}
+
+/*
+ * market_process_order: process an order for any ticker
+ *
+ * market: a market
+ * ord_str: a string describing the order (in the expected format)
+ * time: the time the order was placed.
+ *
+ * Returns: the action report for the order
+ */
+action_report_t *market_process_order(market_t *market, char *ord_str, 
+                                      int time) {
+    assert(market != NULL);
+    assert(ord_str != NULL);
+    order_msg_t msg;
+    enum parse_status status = parse_order_line(ord_str, &msg);
+    if (status != PARSE_OK) {
+        fprintf(stderr, "market_process_order: %s: %s\n", 
+                parse_status_str(status), ord_str);
+        return mk_action_report("");
+    }
+    return market_process_msg(market, &msg, time);
+}
+
+/*
+ * market_process_msg: process an order that has already been parsed
+ *
+ * market: a market
+ * msg: the fields of the order
+ * time: the time the order was placed.
+ *
+ * Returns: the action report for the order
+ */
+action_report_t *market_process_msg(market_t *market, order_msg_t *msg,
+                                    int time) {
+    assert(msg != NULL);
+    bool known = msg->symbol >= 0 && msg->symbol < num_symbols();
+    return market_process_msg_into(market, msg, time, 
+        mk_action_report(known ? symbol_name(msg->symbol) : ""));
+}
+
+/*
+ * market_process_msg_into: process an order that has already been
+ *   parsed, recording the actions in a report supplied by the caller
+ *
+ * market: a market
+ * msg: the fields of the order
+ * time: the time the order was placed.
+ * out: the report to fill. It is reset first.
+ *
+ * Returns: out
+ */
+action_report_t *market_process_msg_into(market_t *market, 
+                                         order_msg_t *msg, int time,
+                                         action_report_t *out) {
+    assert(market != NULL);
+    assert(msg != NULL);
+    if (msg->symbol < 0 || msg->symbol >= num_symbols()) {
+        fprintf(stderr, "market_process_msg: %s: oref %lld\n",
+                parse_status_str(PARSE_BAD_TICKER), msg->oref);
+        reset_action_report(out, "");
+        return out;
+    }
+    return process_order_msg_into(get_exchange(market, msg->symbol), msg, 
+                                  time, out);
+}
+
+/*
+ * market_exchange: find the exchange for a ticker
+ *
+ * market: a market
+ * ticker: the ticker symbol
+ *
+ * Returns: the exchange, or NULL if no order for the ticker has arrived
+ */
+exchange_t *market_exchange(market_t *market, char *ticker) {
+    int symbol = find_symbol(ticker);
+    if (symbol == NO_SYMBOL || symbol >= market->num_slots) {
+        return NULL;
+    }
+    return market->by_symbol[symbol];
+}
+
+/*
+ * market_num_exchanges: count the exchanges in a market
+ *
+ * market: a market
+ *
+ * Returns: the number of tickers that have had an order
+ */
+int market_num_exchanges(market_t *market) {
+    return market->num_exchanges;
+}
+
+/*
+ * market_track_latency: time the orders processed by any of the
+ *   market's exchanges from now on
+ *
+ * market: a market
+ * stats: the histograms to record into, or NULL to stop timing
+ */
+void market_track_latency(market_t *market, latency_stats_t *stats) {
+    market->latency = stats;
+    for (int i = 0; i < market->num_slots; i++) {
+        if (market->by_symbol[i] != NULL) {
+            exchange_track_latency(market->by_symbol[i], stats);
+        }
+    }
+}
+
+/*
+ * print_market: print the contents of every exchange in the market
+ *
+ * market: a market
+ */
+void print_market(market_t *market) {
+    for (int i = 0; i < market->num_slots; i++) {
+        if (market->by_symbol[i] != NULL) {
+            print_exchange(market->by_symbol[i]);
+        }
+    }
+}
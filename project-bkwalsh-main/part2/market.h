@@ -0,0 +1,110 @@
+/*
+ * CS 152, Spring 2022
+ * Market Interface.
+ *
+ * A market holds an exchange for every ticker it has seen and sends
+ * each order to the exchange for the order's ticker, so one market can
+ * replay an order file that mixes many tickers. The exchanges share one
+ * order pool. Tickers are looked up by their interned id (symbols.h).
+ */
+
+#ifndef MARKET_H
+#define MARKET_H
+
+/* The type for a market.  This type is opaque */
+typedef struct market market_t;
+
+struct latency_stats;
+
+/*
+ * mk_market: make a market with no exchanges. An exchange is added the
+ *   first time an order for its ticker arrives.
+ *
+ * Returns: a market
+ */
+market_t *mk_market();
+
+/*
+ * free_market: free a market along with all of its exchanges
+ *
+ * market: a market
+ */
+void free_market(market_t *market);
+
+/*
+ * market_process_order: process an order for any ticker
+ *
+ * market: a market
+ * ord_str: a string describing the order (in the expected format)
+ * time: the time the order was placed.
+ *
+ * Returns: the action report for the order, for the order's ticker. A
+ *   line that does not parse is reported on stderr and gets an empty
+ *   report with an empty ticker.
+ */
+action_report_t *market_process_order(market_t *market, char *ord_str, 
+                                      int time);
+
+/*
+ * market_process_msg: process an order that has already been parsed
+ *
+ * market: a market
+ * msg: the fields of the order (see order.h)
+ * time: the time the order was placed.
+ *
+ * Returns: the action report for the order, for the order's ticker
+ */
+action_report_t *market_process_msg(market_t *market, struct order_msg *msg,
+                                    int time);
+
+/*
+ * market_process_msg_into: like market_process_msg, but records the
+ *   actions in a report supplied by the caller, which is reset first
+ *
+ * market: a market
+ * msg: the fields of the order (see order.h)
+ * time: the time the order was placed.
+ * out: the report to fill
+ *
+ * Returns: out
+ */
+action_report_t *market_process_msg_into(market_t *market, 
+                                         struct order_msg *msg, int time,
+                                         action_report_t *out);
+
+/*
+ * market_exchange: find the exchange for a ticker
+ *
+ * market: a market
+ * ticker: the ticker symbol
+ *
+ * Returns: the exchange, or NULL if no order for the ticker has arrived
+ */
+exchange_t *market_exchange(market_t *market, char *ticker);
+
+/*
+ * market_num_exchanges: count the exchanges in a market
+ *
+ * market: a market
+ *
+ * Returns: the number of tickers that have had an order
+ */
+int market_num_exchanges(market_t *market);
+
+/*
+ * market_track_latency: time the orders processed by any of the
+ *   market's exchanges, including ones added later (see latency.h)
+ *
+ * market: a market
+ * stats: the histograms to record into, or NULL to stop timing
+ */
+void market_track_latency(market_t *market, struct latency_stats *stats);
+
+/*
+ * print_market: print the contents of every exchange in the market
+ *
+ * market: a market
+ */
+void print_market(market_t *market);
+
+#endif
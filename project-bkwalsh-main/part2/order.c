@@ -15,10 +15,11 @@
 
 #include "util.h"
 #include "order.h"
+#include "order_pool.h"
+#include "symbols.h"
+#include "trace.h"
 
 #define MAX_ORDER_LEN 1000
-#define MAX_TICKER_LEN 10
-#define NUM_FIELDS 8
 
 /*
  * mk_order: make an order from the parts
@@ -37,16 +38,38 @@
 order_t *mk_order(char venue, char *ticker, char typ, char book, 
 		  int shares, long long price, long long oref, int time) {
     order_t *o = (order_t*) ck_malloc(sizeof(order_t), "mk_order");
+    fill_order(o, venue, intern_symbol(ticker), typ, book, shares, price,
+               oref, time);
+    TRACE_ORDER(TRACE_ORDER_MADE, oref);
+    return o;
+}
+
+
+/*
+ * fill_order: set every field of an order from the parts. The order is
+ *  not linked into anything and does not belong to a pool.
+ *
+ * o: the order to fill
+ * symbol: the interned id of the ticker symbol
+ * The remaining arguments are as for mk_order
+ */
+void fill_order(order_t *o, char venue, int symbol, char typ, char book,
+                int shares, long long price, long long oref, int time) {
     o->venue = venue;
-    o->ticker = ck_strdup(ticker, "mk_order");
+    o->symbol = symbol;
+    o->ticker = symbol_name(symbol);
     o->type = typ;
     o->book = book;
     o->shares = shares;
     o->price = price;
     o->oref = oref;
     o->time = time;
-    printf("making...%lld\n", oref);
-    return o;
+    o->next = NULL;
+    o->prev = NULL;
+    o->level = NULL;
+    o->hnext = NULL;
+    o->slot = -1;
+    o->pool = NULL;
 }
 
 
@@ -62,30 +85,231 @@ order_t *mk_order(char venue, char *ticker, char typ, char book,
  *   properly.
  */
 order_t *mk_order_from_line(char *line, int time) {
-    char venue, typ, book;
-    char ticker[MAX_TICKER_LEN+1];
-    int shares;
-    long long price, oref;
+    return mk_order_from_line_in(NULL, line, time);
+}
 
-    int num_matched = sscanf(line, "%c,%[^,],%c,%c,%d,%lld,%lld",
-                             &venue, ticker, &typ, &book, &shares, 
-                             &price, &oref);
 
-    if (num_matched != NUM_FIELDS-1) {
+/*
+ * mk_order_from_line_in: like mk_order_from_line, but takes the space 
+ *  for the order from a pool.
+ *
+ * pool: the pool to use, or NULL to malloc the order
+ * line: a string describing the order.  
+ *  Format:Venue,Ticker,Type,Book,Shares,Price,Oref
+ * time: the time the order was placed
+ *
+ * Returns: the order or NULL, if the string did not parse
+ *   properly.
+ */
+order_t *mk_order_from_line_in(order_pool_t *pool, char *line, int time) {
+    order_msg_t msg;
+    if (parse_order_line(line, &msg) != PARSE_OK) {
         return NULL;
     }
+    return mk_order_from_msg_in(pool, &msg, time);
+}
+
+
+/*
+ * mk_order_from_msg_in: constructs an order from a parsed order line
+ *
+ * pool: the pool to use, or NULL to malloc the order
+ * msg: the parsed order
+ * time: the time the order was placed
+ *
+ * Returns: the order
+ */
+order_t *mk_order_from_msg_in(order_pool_t *pool, order_msg_t *msg, 
+                              int time) {
+    if (pool != NULL) {
+        return pool_mk_order(pool, msg->venue, msg->symbol, msg->type, 
+                             msg->book, msg->shares, msg->price, msg->oref,
+                             time);
+    }
+    order_t *o = (order_t*) ck_malloc(sizeof(order_t), "mk_order_from_msg");
+    fill_order(o, msg->venue, msg->symbol, msg->type, msg->book, 
+               msg->shares, msg->price, msg->oref, time);
+    TRACE_ORDER(TRACE_ORDER_MADE, msg->oref);
+    return o;
+}
+
+
+/*
+ * parse_number: reads a decimal number made of digits only (no sign,
+ *  no spaces) that is no bigger than max
+ *
+ * p: where the number starts
+ * end: end of the line
+ * max: the largest value allowed
+ * out: out parameter for the value
+ *
+ * Returns: pointer just past the last digit, or NULL if there were no
+ *  digits or the number is too big
+ */
+static const char *parse_number(const char *p, const char *end, 
+                                long long max, long long *out) {
+    const char *start = p;
+    long long n = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        int digit = *p - '0';
+        if (n > (max - digit) / 10) {
+            return NULL;
+        }
+        n = n * 10 + digit;
+        p++;
+    }
+    if (p == start) {
+        return NULL;
+    }
+    *out = n;
+    return p;
+}
+
+
+/*
+ * parse_order: parses one order line in a single pass, in place. The
+ *  line runs from start up to (not including) end and does not need to
+ *  be NUL terminated. A trailing carriage return is allowed. The ticker
+ *  is interned only once the whole line has parsed.
+ *
+ * start: first character of the line
+ * end: one past the last character of the line
+ * msg: out parameter filled in with the fields of the order
+ *
+ * Returns: PARSE_OK, or the first problem found with the line
+ */
+enum parse_status parse_order(const char *start, const char *end, 
+                              order_msg_t *msg) {
+    const char *p = start;
+    long long value;
+
+    if (end > start && end[-1] == '\r') {
+        end--;
+    }
+    if (p == end) {
+        return PARSE_EMPTY;
+    }
+
+    msg->venue = *p++;
+    if (p == end || *p++ != ',') {
+        return PARSE_BAD_VENUE;
+    }
 
-    return mk_order(venue, ticker, typ, book, shares, price, oref, time);
+    const char *ticker = p;
+    while (p < end && *p != ',') {
+        p++;
+    }
+    if (p == ticker || p == end) {
+        return PARSE_BAD_TICKER;
+    }
+    int ticker_len = p - ticker;
+    p++;
+
+    if (end - p < 2 || (*p != 'A' && *p != 'C') || p[1] != ',') {
+        return PARSE_BAD_TYPE;
+    }
+    msg->type = *p;
+    p += 2;
+
+    if (end - p < 2 || (*p != 'B' && *p != 'S') || p[1] != ',') {
+        return PARSE_BAD_BOOK;
+    }
+    msg->book = *p;
+    p += 2;
+
+    p = parse_number(p, end, INT_MAX, &value);
+    if (p == NULL || value == 0 || p == end || *p++ != ',') {
+        return PARSE_BAD_SHARES;
+    }
+    msg->shares = (int) value;
+
+    p = parse_number(p, end, LLONG_MAX, &value);
+    if (p == NULL || p == end || *p++ != ',') {
+        return PARSE_BAD_PRICE;
+    }
+    msg->price = value;
+
+    p = parse_number(p, end, LLONG_MAX, &value);
+    if (p == NULL) {
+        return PARSE_BAD_OREF;
+    }
+    msg->oref = value;
+
+    if (p != end) {
+        return PARSE_TRAILING;
+    }
+    msg->symbol = intern_symbol_n(ticker, ticker_len);
+    return PARSE_OK;
+}
+
+
+/*
+ * parse_order_line: parses an order line that ends at a newline or at
+ *  the end of the string. See parse_order.
+ *
+ * line: a string describing the order.  
+ *  Format:Venue,Ticker,Type,Book,Shares,Price,Oref
+ * msg: out parameter filled in with the fields of the order
+ *
+ * Returns: PARSE_OK, or the first problem found with the line
+ */
+enum parse_status parse_order_line(const char *line, order_msg_t *msg) {
+    const char *end = line;
+    while (*end != '\0' && *end != '\n') {
+        end++;
+    }
+    return parse_order(line, end, msg);
+}
+
+
+/*
+ * parse_status_str: describes a parse status
+ *
+ * Returns: a constant string
+ */
+const char *parse_status_str(enum parse_status status) {
+    switch (status) {
+    case PARSE_OK:
+        return "ok";
+    case PARSE_EMPTY:
+        return "empty line";
+    case PARSE_BAD_VENUE:
+        return "bad venue";
+    case PARSE_BAD_TICKER:
+        return "bad ticker";
+    case PARSE_BAD_TYPE:
+        return "bad type (expected A or C)";
+    case PARSE_BAD_BOOK:
+        return "bad book (expected B or S)";
+    case PARSE_BAD_SHARES:
+        return "bad shares";
+    case PARSE_BAD_PRICE:
+        return "bad price";
+    case PARSE_BAD_OREF:
+        return "bad oref";
+    case PARSE_TRAILING:
+        return "unexpected characters after oref";
+    }
+    return "unknown parse status";
 }
 
 /*
- * copy_order: make a copy of an order
+ * copy_order: make a copy of an order. Copies of pooled orders come
+ *  from the same pool.
  *
  * Returns: a pointer to an order struct.
  */
 order_t *copy_order(order_t *order) {
-  return mk_order(order->venue, order->ticker, order->type, order->book, 
-		  order->shares, order->price, order->oref, order->time);
+  if (order->pool != NULL) {
+      return pool_mk_order(order->pool, order->venue, order->symbol, 
+                           order->type, order->book, order->shares, 
+                           order->price, order->oref, order->time);
+  }
+  order_t *o = (order_t*) ck_malloc(sizeof(order_t), "copy_order");
+  fill_order(o, order->venue, order->symbol, order->type, order->book, 
+             order->shares, order->price, order->oref, order->time);
+  TRACE_ORDER(TRACE_ORDER_MADE, order->oref);
+  return o;
 }
 
 
@@ -95,8 +319,11 @@ order_t *copy_order(order_t *order) {
  * order: the order to free
  */
 void free_order(order_t *order) {
-    printf("freeing...%lld\n", order->oref); 
-    free(order->ticker);
+    TRACE_ORDER(TRACE_ORDER_FREED, order->oref);
+    if (order->pool != NULL) {
+        pool_free_order(order->pool, order);
+        return;
+    }
     free(order);
 }
 
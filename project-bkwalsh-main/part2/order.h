@@ -12,15 +12,46 @@
 
 typedef struct order {
     char venue;
-    char *ticker;
+    char *ticker;               // interned, shared with every other order
+    int symbol;                 // interned id of ticker (see symbols.h)
     char type;
     char book;
     int shares;
     long long price;
     long long oref;
     int time;
+    struct order *next;         // next order resting at the same price
+    struct order *prev;         // previous order resting at the same price
+    struct price_level *level;  // price level the order rests on, if booked
+    struct order *hnext;        // next order in the same oref index bucket
+    int slot;                   // heap slot the order rests in, if booked
+    struct order_pool *pool;    // pool the order came from, NULL if malloced
 } order_t;
 
+/* An order line's fields once parsed, before they become an order_t.
+ * The ticker has already been interned.
+ */
+typedef struct order_msg {
+    long long price;
+    long long oref;
+    int shares;
+    int symbol;                 // interned id of the ticker
+    char venue;
+    char type;
+    char book;
+} order_msg_t;
+
+/* What parse_order found wrong with a line, if anything */
+enum parse_status {PARSE_OK, PARSE_EMPTY, PARSE_BAD_VENUE, PARSE_BAD_TICKER, 
+                   PARSE_BAD_TYPE, PARSE_BAD_BOOK, PARSE_BAD_SHARES, 
+                   PARSE_BAD_PRICE, PARSE_BAD_OREF, PARSE_TRAILING};
+
+/*
+ * copy_order: make a copy of an order. Copies of pooled orders come
+ *  from the same pool.
+ *
+ * Returns: a pointer to an order struct.
+ */
 order_t *copy_order(order_t *order);
 
 /*
@@ -42,6 +73,18 @@ order_t *mk_order(char venue, char *ticker, char typ, char book,
                   int time);
 
 
+/*
+ * fill_order: set every field of an order from the parts. The order is
+ *  not linked into anything and does not belong to a pool.
+ *
+ * o: the order to fill
+ * symbol: the interned id of the ticker symbol
+ * The remaining arguments are as for mk_order
+ */
+void fill_order(order_t *o, char venue, int symbol, char typ, char book,
+                int shares, long long price, long long oref, int time);
+
+
 /*
 
  * mk_order_from_line: constructs an order from an string describing
@@ -56,8 +99,72 @@ order_t *mk_order(char venue, char *ticker, char typ, char book,
 order_t *mk_order_from_line(char *line, int time);
 
 
+/*
+ * mk_order_from_line_in: like mk_order_from_line, but takes the space 
+ *  for the order from a pool.
+ *
+ * pool: the pool to use, or NULL to malloc the order
+ * line: a string describing the order.  
+ *  Format:Venue,Ticker,Type,Book,Shares,Price,Oref
+ * time: the time the order was placed
+ *
+ * Returns: an order, or NULL if the string did not parse properly
+ */
+order_t *mk_order_from_line_in(struct order_pool *pool, char *line, int time);
+
+
+/*
+ * mk_order_from_msg_in: constructs an order from a parsed order line
+ *
+ * pool: the pool to use, or NULL to malloc the order
+ * msg: the parsed order
+ * time: the time the order was placed
+ *
+ * Returns: the order
+ */
+order_t *mk_order_from_msg_in(struct order_pool *pool, order_msg_t *msg, 
+                              int time);
+
+
+/*
+ * parse_order: parses one order line in a single pass, in place. The
+ *  line runs from start up to (not including) end and does not need to
+ *  be NUL terminated. A trailing carriage return is allowed. Shares must
+ *  be positive; shares, price and oref are plain digits.
+ *
+ * start: first character of the line
+ * end: one past the last character of the line
+ * msg: out parameter filled in with the fields of the order
+ *
+ * Returns: PARSE_OK, or the first problem found with the line
+ */
+enum parse_status parse_order(const char *start, const char *end, 
+                              order_msg_t *msg);
+
+
+/*
+ * parse_order_line: parses an order line that ends at a newline or at
+ *  the end of the string. See parse_order.
+ *
+ * line: a string describing the order.  
+ *  Format:Venue,Ticker,Type,Book,Shares,Price,Oref
+ * msg: out parameter filled in with the fields of the order
+ *
+ * Returns: PARSE_OK, or the first problem found with the line
+ */
+enum parse_status parse_order_line(const char *line, order_msg_t *msg);
+
+
+/*
+ * parse_status_str: describes a parse status
+ *
+ * Returns: a constant string
+ */
+const char *parse_status_str(enum parse_status status);
+
+
 /* 
- * free_order: free an order 
+ * free_order: free an order (pooled orders go back to their pool)
  */
 void free_order(order_t *order);
 
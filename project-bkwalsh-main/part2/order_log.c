@@ -0,0 +1,449 @@
+/*
+ * CS 152, Spring 2022
+ * Binary Order Log Format
+ *
+ * The writer keeps only the range of each field from the first pass,
+ * and one chunk of encoded records in the second.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "order.h"
+#include "symbols.h"
+#include "order_log.h"
+#include "util.h"
+
+#define FLAG_BYTES 4            // venue, type, book and status
+#define WRITE_RECORDS 4096      // records encoded per write
+
+_Static_assert(sizeof(order_log_header_t) == 40, "order log header size");
+
+struct order_log_writer {
+    long num_measured;          // lines seen by each pass
+    long num_added;
+    long long min[ORDER_LOG_FIELDS];    // range of each field
+    long long max[ORDER_LOG_FIELDS];
+    order_log_header_t header;  // filled in by start_order_log
+    int fd;
+    char *records;              // WRITE_RECORDS encoded records
+    int num_buffered;
+};
+
+struct order_log {
+    const char *records;        // inside the caller's buffer
+    long num_orders;
+    int record_len;
+    uint8_t widths[ORDER_LOG_FIELDS];
+    int *symbols;               // log's ticker number -> interned id
+    int num_symbols;
+};
+
+/*
+ * field_width: the fewest bytes that hold every value from min to max
+ *   as a signed integer (0 if they are all 0)
+ */
+static int field_width(long long min, long long max) {
+    if (min == 0 && max == 0) {
+        return 0;
+    } else if (min >= INT8_MIN && max <= INT8_MAX) {
+        return 1;
+    } else if (min >= INT16_MIN && max <= INT16_MAX) {
+        return 2;
+    } else if (min >= INT32_MIN && max <= INT32_MAX) {
+        return 4;
+    }
+    return 8;
+}
+
+/*
+ * put_field: store a value in width bytes
+ *
+ * Returns: the byte after it
+ */
+static char *put_field(char *p, long long value, int width) {
+    int8_t v8 = value;
+    int16_t v16 = value;
+    int32_t v32 = value;
+    int64_t v64 = value;
+    switch (width) {
+    case 1:
+        memcpy(p, &v8, 1);
+        break;
+    case 2:
+        memcpy(p, &v16, 2);
+        break;
+    case 4:
+        memcpy(p, &v32, 4);
+        break;
+    case 8:
+        memcpy(p, &v64, 8);
+        break;
+    }
+    return p + width;
+}
+
+/*
+ * get_field: read a value stored by put_field
+ *
+ * Returns: the value
+ */
+static long long get_field(const char *p, int width) {
+    int8_t v8;
+    int16_t v16;
+    int32_t v32;
+    int64_t v64;
+    switch (width) {
+    case 1:
+        memcpy(&v8, p, 1);
+        return v8;
+    case 2:
+        memcpy(&v16, p, 2);
+        return v16;
+    case 4:
+        memcpy(&v32, p, 4);
+        return v32;
+    case 8:
+        memcpy(&v64, p, 8);
+        return v64;
+    }
+    return 0;
+}
+
+/*
+ * write_all: write a buffer, retrying short writes
+ */
+static void write_all(int fd, const void *buf, size_t len) {
+    const char *p = (const char *) buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            fprintf(stderr, "order log: %s\n", strerror(errno));
+            exit(1);
+        }
+        p += n;
+        len -= n;
+    }
+}
+
+/*
+ * line_fields: the numeric fields of a line as the log stores them
+ *
+ * line: the line's number in the order file
+ * fields: out parameter, indexed by enum order_log_field
+ */
+static void line_fields(order_msg_t *msg, enum parse_status status,
+                        int time, long line, long long *fields) {
+    for (int f = 0; f < ORDER_LOG_FIELDS; f++) {
+        fields[f] = 0;
+    }
+    fields[ORDER_LOG_TIME] = (long long) time - line;
+    if (status == PARSE_OK) {
+        fields[ORDER_LOG_PRICE] = msg->price;
+        fields[ORDER_LOG_OREF] = msg->oref;
+        fields[ORDER_LOG_SHARES] = msg->shares;
+        fields[ORDER_LOG_SYMBOL] = msg->symbol;
+    }
+}
+
+/*
+ * mk_order_log_writer: make a writer for a log
+ *
+ * Returns: a writer
+ */
+order_log_writer_t *mk_order_log_writer() {
+    order_log_writer_t *w = (order_log_writer_t *)
+        ck_malloc(sizeof(order_log_writer_t), "mk_order_log_writer");
+    w->num_measured = 0;
+    w->num_added = 0;
+    for (int f = 0; f < ORDER_LOG_FIELDS; f++) {
+        w->min[f] = 0;
+        w->max[f] = 0;
+    }
+    w->fd = -1;
+    w->records = NULL;
+    w->num_buffered = 0;
+    return w;
+}
+
+/*
+ * order_log_measure: first pass; note the next line of an order file
+ *
+ * w: a writer
+ * msg: the parsed order (ignored unless status is PARSE_OK)
+ * status: what parsing the line found
+ * time: the time of the order
+ */
+void order_log_measure(order_log_writer_t *w, order_msg_t *msg,
+                       enum parse_status status, int time) {
+    assert(w->fd < 0);
+    long long fields[ORDER_LOG_FIELDS];
+    line_fields(msg, status, time, w->num_measured++, fields);
+    for (int f = 0; f < ORDER_LOG_FIELDS; f++) {
+        if (fields[f] < w->min[f]) {
+            w->min[f] = fields[f];
+        }
+        if (fields[f] > w->max[f]) {
+            w->max[f] = fields[f];
+        }
+    }
+}
+
+/*
+ * start_order_log: write the header and the symbol table
+ *
+ * w: a writer
+ * fd: an open file descriptor
+ */
+void start_order_log(order_log_writer_t *w, int fd) {
+    assert(w->fd < 0 && fd >= 0);
+    order_log_header_t *header = &w->header;
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, ORDER_LOG_MAGIC, ORDER_LOG_MAGIC_LEN);
+    header->byte_order = ORDER_LOG_BYTE_ORDER;
+    header->num_symbols = num_symbols();
+    header->num_orders = w->num_measured;
+    header->record_len = FLAG_BYTES;
+    for (int f = 0; f < ORDER_LOG_FIELDS; f++) {
+        header->widths[f] = field_width(w->min[f], w->max[f]);
+        header->record_len += header->widths[f];
+    }
+
+    for (uint32_t i = 0; i < header->num_symbols; i++) {
+        header->symbols_len += sizeof(uint32_t) + strlen(symbol_name(i));
+    }
+    char *names = (char *) ck_malloc(header->symbols_len + 1,
+                                     "start_order_log");
+    char *p = names;
+    for (uint32_t i = 0; i < header->num_symbols; i++) {
+        char *name = symbol_name(i);
+        uint32_t name_len = strlen(name);
+        memcpy(p, &name_len, sizeof(name_len));
+        memcpy(p + sizeof(name_len), name, name_len);
+        p += sizeof(name_len) + name_len;
+    }
+    w->records = (char *) ck_malloc(WRITE_RECORDS * header->record_len,
+                                    "start_order_log");
+
+    w->fd = fd;
+    write_all(fd, header, sizeof(*header));
+    write_all(fd, names, header->symbols_len);
+    ck_free(names);
+}
+
+/*
+ * order_log_add: second pass; write the next line of an order file
+ *
+ * w: a writer
+ * msg: the parsed order (ignored unless status is PARSE_OK)
+ * status: what parsing the line found
+ * time: the time of the order
+ */
+void order_log_add(order_log_writer_t *w, order_msg_t *msg,
+                   enum parse_status status, int time) {
+    assert(w->fd >= 0);
+    long long fields[ORDER_LOG_FIELDS];
+    line_fields(msg, status, time, w->num_added, fields);
+    bool measured = w->num_added < w->num_measured;
+    for (int f = 0; f < ORDER_LOG_FIELDS; f++) {
+        measured = measured && fields[f] >= w->min[f] &&
+            fields[f] <= w->max[f];
+    }
+    if (!measured) {
+        fprintf(stderr, "order_log_add: line %ld was not measured\n",
+                w->num_added + 1);
+        exit(1);
+    }
+    char *p = w->records + w->num_buffered * w->header.record_len;
+    for (int f = 0; f < ORDER_LOG_FIELDS; f++) {
+        p = put_field(p, fields[f], w->header.widths[f]);
+    }
+    bool ok = status == PARSE_OK;
+    *p++ = ok ? msg->venue : 0;
+    *p++ = ok ? msg->type : 0;
+    *p++ = ok ? msg->book : 0;
+    *p++ = status;
+    w->num_added++;
+    if (++w->num_buffered == WRITE_RECORDS) {
+        write_all(w->fd, w->records,
+                  (size_t) w->num_buffered * w->header.record_len);
+        w->num_buffered = 0;
+    }
+}
+
+/*
+ * finish_order_log: write the records still buffered
+ *
+ * w: a writer
+ */
+void finish_order_log(order_log_writer_t *w) {
+    assert(w->fd >= 0);
+    if (w->num_added != w->num_measured) {
+        fprintf(stderr, "finish_order_log: %ld lines measured, %ld "
+                "added\n", w->num_measured, w->num_added);
+        exit(1);
+    }
+    write_all(w->fd, w->records,
+              (size_t) w->num_buffered * w->header.record_len);
+    w->num_buffered = 0;
+}
+
+/*
+ * free_order_log_writer: free a writer
+ */
+void free_order_log_writer(order_log_writer_t *w) {
+    if (w->records != NULL) {
+        ck_free(w->records);
+    }
+    ck_free(w);
+}
+
+/*
+ * is_order_log: does a buffer start with the order log magic?
+ *
+ * buf: the start of a file
+ * len: the number of bytes of it in buf
+ */
+bool is_order_log(const char *buf, size_t len) {
+    return len >= ORDER_LOG_MAGIC_LEN &&
+        memcmp(buf, ORDER_LOG_MAGIC, ORDER_LOG_MAGIC_LEN) == 0;
+}
+
+/*
+ * open_order_log: read an order log that is in memory
+ *
+ * buf: the whole log
+ * len: the number of bytes in buf
+ *
+ * Returns: the log, or NULL if buf is not a complete order log written
+ *   on a machine like this one
+ */
+order_log_t *open_order_log(const char *buf, size_t len) {
+    order_log_header_t header;
+    if (len < sizeof(header) || !is_order_log(buf, len)) {
+        fprintf(stderr, "open_order_log: not an order log\n");
+        return NULL;
+    }
+    memcpy(&header, buf, sizeof(header));
+    if (header.byte_order != ORDER_LOG_BYTE_ORDER) {
+        fprintf(stderr, "open_order_log: log is from another kind of "
+                "machine\n");
+        return NULL;
+    }
+    int record_len = FLAG_BYTES;
+    for (int f = 0; f < ORDER_LOG_FIELDS; f++) {
+        int width = header.widths[f];
+        if (width != 0 && width != 1 && width != 2 && width != 4 &&
+            width != 8) {
+            fprintf(stderr, "open_order_log: bad field width\n");
+            return NULL;
+        }
+        record_len += width;
+    }
+    size_t rest = len - sizeof(header);
+    if (header.record_len != record_len || header.num_symbols > INT32_MAX ||
+        header.symbols_len > rest ||
+        (rest - header.symbols_len) / record_len != header.num_orders ||
+        (rest - header.symbols_len) % record_len != 0) {
+        fprintf(stderr, "open_order_log: log is the wrong length\n");
+        return NULL;
+    }
+
+    order_log_t *log = (order_log_t *) ck_malloc(sizeof(order_log_t),
+                                                 "open_order_log");
+    const char *names = buf + sizeof(header);
+    log->records = names + header.symbols_len;
+    log->num_orders = header.num_orders;
+    log->record_len = record_len;
+    memcpy(log->widths, header.widths, sizeof(log->widths));
+    log->num_symbols = header.num_symbols;
+    log->symbols = (int *) ck_malloc(sizeof(int) * (header.num_symbols + 1),
+                                     "open_order_log");
+    size_t left = header.symbols_len;
+    for (int i = 0; i < log->num_symbols; i++) {
+        uint32_t name_len = 0;
+        if (left >= sizeof(name_len)) {
+            memcpy(&name_len, names, sizeof(name_len));
+            names += sizeof(name_len);
+            left -= sizeof(name_len);
+        }
+        if (name_len == 0 || name_len > left || name_len > INT32_MAX) {
+            fprintf(stderr, "open_order_log: bad ticker %d\n", i);
+            free_order_log(log);
+            return NULL;
+        }
+        log->symbols[i] = intern_symbol_n(names, name_len);
+        names += name_len;
+        left -= name_len;
+    }
+    if (left != 0) {
+        fprintf(stderr, "open_order_log: bad symbol table\n");
+        free_order_log(log);
+        return NULL;
+    }
+    return log;
+}
+
+/*
+ * order_log_length: the number of records in a log
+ */
+long order_log_length(order_log_t *log) {
+    return log->num_orders;
+}
+
+/*
+ * order_log_msg: get a record as an order
+ *
+ * log: an order log
+ * i: the record's position
+ * msg: out parameter, the order with its ticker's id in this program
+ * time: out parameter, the time of the order
+ *
+ * Returns: the status of the line
+ */
+enum parse_status order_log_msg(order_log_t *log, long i, order_msg_t *msg,
+                                int *time) {
+    assert(i >= 0 && i < log->num_orders);
+    const char *p = log->records + i * log->record_len;
+    long long fields[ORDER_LOG_FIELDS];
+    for (int f = 0; f < ORDER_LOG_FIELDS; f++) {
+        fields[f] = get_field(p, log->widths[f]);
+        p += log->widths[f];
+    }
+    *time = i + fields[ORDER_LOG_TIME];
+    unsigned char status = p[3];
+    if (status != PARSE_OK) {
+        return status <= PARSE_TRAILING ? status : PARSE_EMPTY;
+    }
+    long long symbol = fields[ORDER_LOG_SYMBOL];
+    if (symbol < 0 || symbol >= log->num_symbols) {
+        return PARSE_BAD_TICKER;
+    }
+    msg->price = fields[ORDER_LOG_PRICE];
+    msg->oref = fields[ORDER_LOG_OREF];
+    msg->shares = fields[ORDER_LOG_SHARES];
+    msg->symbol = log->symbols[symbol];
+    msg->venue = p[0];
+    msg->type = p[1];
+    msg->book = p[2];
+    return PARSE_OK;
+}
+
+/*
+ * free_order_log: free a log opened by open_order_log
+ */
+void free_order_log(order_log_t *log) {
+    ck_free(log->symbols);
+    ck_free(log);
+}
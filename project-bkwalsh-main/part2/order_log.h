@@ -0,0 +1,171 @@
+/*
+ * CS 152, Spring 2022
+ * Binary Order Log Format.
+ *
+ * An order log holds the orders of an order file already parsed, so a
+ * run over the same orders again skips the text parsing. The file is a
+ * header, the symbol table and then one record per line of the original
+ * file:
+ *
+ *   header   order_log_header_t (40 bytes)
+ *   symbols  num_symbols tickers, each a uint32_t length followed by
+ *            that many bytes. Records refer to tickers by their position
+ *            in this table.
+ *   records  num_orders records of record_len bytes each
+ *
+ * A record is the numeric fields of enum order_log_field, in that
+ * order, followed by the venue, type, book and parse status, one byte
+ * each. Each numeric field is stored as a signed integer just wide
+ * enough for every value it takes in this log: widths[f] is 0, 1, 2, 4
+ * or 8 bytes, and a field that is 0 on every line takes no space. The
+ * time is stored as the difference from the line number, so a log made
+ * without a times file has no time bytes at all.
+ *
+ * Numbers are in the byte order of the machine that wrote the log, so a
+ * mapped log can be read in place; a log from a machine with the other
+ * byte order is rejected. ordlog converts an order file (and its times)
+ * to a log, and simulate reads logs as well as order files.
+ *
+ * The header needs the widths, which depend on every line, so a log is
+ * written in two passes over the orders: the writer first measures each
+ * line, then encodes each line again straight to the file. Neither pass
+ * keeps the lines, so writing a log takes the same memory for any
+ * number of orders.
+ */
+
+#ifndef ORDER_LOG_H
+#define ORDER_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "order.h"
+
+#define ORDER_LOG_MAGIC "CS152OL2"
+#define ORDER_LOG_MAGIC_LEN 8
+#define ORDER_LOG_BYTE_ORDER 0x01020304
+
+/* The numeric fields of a record, in the order they are stored */
+enum order_log_field {ORDER_LOG_PRICE, ORDER_LOG_OREF, ORDER_LOG_SHARES,
+                      ORDER_LOG_SYMBOL, ORDER_LOG_TIME, ORDER_LOG_FIELDS};
+
+typedef struct order_log_header {
+    char magic[ORDER_LOG_MAGIC_LEN];    // ORDER_LOG_MAGIC
+    uint32_t byte_order;        // ORDER_LOG_BYTE_ORDER as the writer saw it
+    uint32_t num_symbols;
+    uint64_t symbols_len;       // bytes in the symbol table
+    uint64_t num_orders;
+    uint8_t widths[ORDER_LOG_FIELDS];   // bytes for each numeric field
+    uint8_t record_len;
+    uint8_t unused[2];
+} order_log_header_t;
+
+/* The types for an order log being written and one being read. These
+ * types are opaque */
+typedef struct order_log_writer order_log_writer_t;
+typedef struct order_log order_log_t;
+
+/*
+ * mk_order_log_writer: make a writer for a log
+ *
+ * Returns: a writer
+ */
+order_log_writer_t *mk_order_log_writer();
+
+/*
+ * order_log_measure: first pass; note the next line of an order file
+ *   so that the log has room for it
+ *
+ * w: a writer
+ * msg: the parsed order (ignored unless status is PARSE_OK)
+ * status: what parsing the line found
+ * time: the time of the order
+ */
+void order_log_measure(order_log_writer_t *w, order_msg_t *msg,
+                       enum parse_status status, int time);
+
+/*
+ * start_order_log: write the header and the symbol table once every
+ *   line has been measured. The symbol table is every ticker interned
+ *   so far. Everything that can fail, other than the writes themselves,
+ *   is done before the first byte is written.
+ *
+ * w: a writer
+ * fd: an open file descriptor, which the writer writes to until
+ *   finish_order_log
+ */
+void start_order_log(order_log_writer_t *w, int fd);
+
+/*
+ * order_log_add: second pass; write the next line of an order file.
+ *   The lines must be the ones measured, in the same order.
+ *
+ * w: a writer
+ * msg: the parsed order (ignored unless status is PARSE_OK)
+ * status: what parsing the line found
+ * time: the time of the order
+ */
+void order_log_add(order_log_writer_t *w, order_msg_t *msg,
+                   enum parse_status status, int time);
+
+/*
+ * finish_order_log: write the records still buffered, after the last
+ *   order_log_add
+ *
+ * w: a writer
+ */
+void finish_order_log(order_log_writer_t *w);
+
+/*
+ * free_order_log_writer: free a writer
+ */
+void free_order_log_writer(order_log_writer_t *w);
+
+/*
+ * is_order_log: does a buffer start with the order log magic?
+ *
+ * buf: the start of a file
+ * len: the number of bytes of it in buf
+ */
+bool is_order_log(const char *buf, size_t len);
+
+/*
+ * open_order_log: read an order log that is in memory, usually because
+ *   the file is mapped. The records are read where they are and not
+ *   copied. Interns the log's tickers, so call it from the thread that
+ *   interns tickers.
+ *
+ * buf: the whole log; it must stay valid until the log is freed
+ * len: the number of bytes in buf
+ *
+ * Returns: the log, or NULL (with a message on stderr) if buf is not a
+ *   complete order log written on a machine like this one
+ */
+order_log_t *open_order_log(const char *buf, size_t len);
+
+/*
+ * order_log_length: the number of records in a log
+ */
+long order_log_length(order_log_t *log);
+
+/*
+ * order_log_msg: get a record as an order
+ *
+ * log: an order log
+ * i: the record's position, which is the line number in the order file
+ * msg: out parameter, the order with its ticker's id in this program
+ * time: out parameter, the time of the order
+ *
+ * Returns: the status of the line
+ */
+enum parse_status order_log_msg(order_log_t *log, long i, order_msg_t *msg,
+                                int *time);
+
+/*
+ * free_order_log: free a log opened by open_order_log. The buffer is
+ *   the caller's to free.
+ */
+void free_order_log(order_log_t *log);
+
+#endif
@@ -0,0 +1,126 @@
+/*
+ * CS 152, Spring 2022
+ * Order Pool Implementation
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "order.h"
+#include "order_pool.h"
+#include "trace.h"
+#include "util.h"
+
+typedef struct chunk {
+    struct chunk *next;
+    order_t orders[];
+} chunk_t;
+
+struct order_pool {
+    chunk_t *chunks;       // every chunk allocated, newest first
+    order_t *free_list;    // free orders, linked through order->next
+    long hits;             // orders served from the free list
+    long misses;           // orders that needed a new chunk first
+};
+
+#define CHUNK_NODES 1024
+
+/*
+ * mk_order_pool: make an empty pool. The first chunk is allocated on
+ *   the first request for an order.
+ *
+ * Returns: a pool
+ */
+order_pool_t *mk_order_pool() {
+    order_pool_t *pool = (order_pool_t *) ck_malloc(sizeof(order_pool_t),
+                                                    "mk_order_pool");
+    pool->chunks = NULL;
+    pool->free_list = NULL;
+    pool->hits = 0;
+    pool->misses = 0;
+    return pool;
+}
+
+/*
+ * free_order_pool: free a pool along with all of its chunks. Every
+ *   order from the pool must already be freed.
+ *
+ * pool: the pool
+ */
+void free_order_pool(order_pool_t *pool) {
+    chunk_t *curr = pool->chunks;
+    while (curr != NULL) {
+        chunk_t *next = curr->next;
+        ck_free(curr);
+        curr = next;
+    }
+    ck_free(pool);
+}
+
+/*
+ * grow_pool: add a chunk to the pool and put its slots on the free list
+ */
+static void grow_pool(order_pool_t *pool) {
+    chunk_t *chunk = (chunk_t *) ck_malloc(sizeof(chunk_t) + 
+                                           sizeof(order_t) * CHUNK_NODES,
+                                           "grow_pool");
+    chunk->next = pool->chunks;
+    pool->chunks = chunk;
+    for (int i = CHUNK_NODES - 1; i >= 0; i--) {
+        chunk->orders[i].next = pool->free_list;
+        pool->free_list = &chunk->orders[i];
+    }
+}
+
+/*
+ * pool_mk_order: make an order from the parts, using space from the pool.
+ *   The order is freed with free_order, which returns it to the pool.
+ *
+ * pool: the pool
+ * The remaining arguments are as for mk_order
+ *
+ * Returns: an order
+ */
+order_t *pool_mk_order(order_pool_t *pool, char venue, int symbol, 
+                       char typ, char book, int shares, long long price, 
+                       long long oref, int time) {
+    if (pool->free_list == NULL) {
+        grow_pool(pool);
+        pool->misses++;
+    } else {
+        pool->hits++;
+    }
+    order_t *o = pool->free_list;
+    pool->free_list = o->next;
+    fill_order(o, venue, symbol, typ, book, shares, price, oref, time);
+    o->pool = pool;
+    TRACE_ORDER(TRACE_ORDER_MADE, oref);
+    return o;
+}
+
+/*
+ * pool_free_order: put an order from the pool back on its free list.
+ *   Called by free_order for pooled orders.
+ *
+ * pool: the pool the order came from
+ * order: the order
+ */
+void pool_free_order(order_pool_t *pool, order_t *order) {
+    assert(order->pool == pool);
+    order->next = pool->free_list;
+    pool->free_list = order;
+}
+
+/*
+ * order_pool_stats: get the pool's counters
+ *
+ * pool: the pool
+ * hits: out parameter, orders served from the free list
+ * misses: out parameter, orders that needed a new chunk first
+ */
+void order_pool_stats(order_pool_t *pool, long *hits, long *misses) {
+    *hits = pool->hits;
+    *misses = pool->misses;
+}
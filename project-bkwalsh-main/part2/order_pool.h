@@ -0,0 +1,65 @@
+/*
+ * CS 152, Spring 2022
+ * Order Pool Interface.
+ *
+ * A slab allocator for order_t. Orders are carved out of fixed-size
+ * chunks and go back on a free list when they are freed, so an exchange
+ * that keeps roughly the same number of orders alive stops calling
+ * malloc once the pool has grown to fit.
+ */
+
+#ifndef ORDER_POOL_H
+#define ORDER_POOL_H
+
+/* The pool type is opaque */
+typedef struct order_pool order_pool_t;
+
+/*
+ * mk_order_pool: make an empty pool. The first chunk is allocated on
+ *   the first request for an order.
+ *
+ * Returns: a pool
+ */
+order_pool_t *mk_order_pool();
+
+/*
+ * free_order_pool: free a pool along with all of its chunks. Every
+ *   order from the pool must already be freed.
+ *
+ * pool: the pool
+ */
+void free_order_pool(order_pool_t *pool);
+
+/*
+ * pool_mk_order: make an order from the parts, using space from the pool.
+ *   The order is freed with free_order, which returns it to the pool.
+ *
+ * pool: the pool
+ * symbol: the interned id of the ticker symbol
+ * The remaining arguments are as for mk_order
+ *
+ * Returns: an order
+ */
+order_t *pool_mk_order(order_pool_t *pool, char venue, int symbol, 
+                       char typ, char book, int shares, long long price, 
+                       long long oref, int time);
+
+/*
+ * pool_free_order: put an order from the pool back on its free list.
+ *   Called by free_order for pooled orders.
+ *
+ * pool: the pool the order came from
+ * order: the order
+ */
+void pool_free_order(order_pool_t *pool, order_t *order);
+
+/*
+ * order_pool_stats: get the pool's counters
+ *
+ * pool: the pool
+ * hits: out parameter, orders served from the free list
+ * misses: out parameter, orders that needed a new chunk first
+ */
+void order_pool_stats(order_pool_t *pool, long *hits, long *misses);
+
+#endif
@@ -0,0 +1,231 @@
+/*
+ * CS 152, Spring 2022
+ * Order Log Converter
+ *
+ * Parses an order file once and writes it as a binary order log
+ * (order_log.h), which simulate can read without parsing:
+ *
+ *   ./ordlog tests/test9_orders.csv test9.bin tests/test9_times.csv
+ *   ./simulate -m test9.bin -
+ *
+ * Without a times file each order's time is its line number, as in
+ * simulate. A times file starts with the number of times, followed by
+ * one time per line of the order file.
+ *
+ * The order file is mapped and parsed twice: once to measure the lines
+ * for the log's header and once to write them out (see order_log.h).
+ * Orders from stdin are copied to a temporary file first, so memory use
+ * does not grow with the input.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "order.h"
+#include "batch_parse.h"
+#include "order_log.h"
+#include "util.h"
+
+#define READ_CHUNK (4 << 20)
+#define PARSE_LINES 4096        // lines parsed at a time
+
+/*
+ * copy_stdin: copy stdin to a temporary file, a chunk at a time
+ *
+ * Returns: the file, positioned at its start
+ */
+static FILE *copy_stdin() {
+    FILE *copy = tmpfile();
+    if (copy == NULL) {
+        fprintf(stderr, "ordlog: cannot make a temporary file\n");
+        exit(1);
+    }
+    char *buf = (char *) ck_malloc(READ_CHUNK, "copy_stdin");
+    while (true) {
+        ssize_t got = read(STDIN_FILENO, buf, READ_CHUNK);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0) {
+            perror("ordlog: read");
+            exit(1);
+        }
+        if (got == 0) {
+            break;
+        }
+        if (fwrite(buf, 1, got, copy) != (size_t) got) {
+            fprintf(stderr, "ordlog: cannot copy stdin\n");
+            exit(1);
+        }
+    }
+    ck_free(buf);
+    if (fflush(copy) != 0) {
+        fprintf(stderr, "ordlog: cannot copy stdin\n");
+        exit(1);
+    }
+    rewind(copy);
+    return copy;
+}
+
+/*
+ * map_file: map all of a file into memory
+ *
+ * len: out parameter, the number of bytes mapped
+ *
+ * Returns: the mapping, or NULL if the file is empty
+ */
+static char *map_file(int fd, size_t *len) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("ordlog: stat");
+        exit(1);
+    }
+    *len = st.st_size;
+    if (*len == 0) {
+        return NULL;
+    }
+    char *map = (char *) mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("ordlog: mmap");
+        exit(1);
+    }
+    posix_madvise(map, *len, POSIX_MADV_SEQUENTIAL);
+    return map;
+}
+
+/*
+ * open_times: open a times file and read how many times it has
+ *
+ * num_times: out parameter, the count at the top of the file
+ */
+static FILE *open_times(char *filename, long *num_times) {
+    FILE *times = fopen(filename, "r");
+    if (times == NULL || fscanf(times, "%ld", num_times) != 1) {
+        fprintf(stderr, "ordlog: cannot read times from %s\n", filename);
+        exit(1);
+    }
+    return times;
+}
+
+/*
+ * next_time: read the time for the next line
+ *
+ * times: the times file, or NULL to use the line number
+ * line: the line number
+ */
+static int next_time(FILE *times, long line) {
+    if (times == NULL) {
+        return line;
+    }
+    int time;
+    if (fscanf(times, "%d", &time) != 1) {
+        fprintf(stderr, "ordlog: no time for line %ld\n", line + 1);
+        exit(1);
+    }
+    return time;
+}
+
+/*
+ * log_pass: parse every line of the orders, with its time, and hand it
+ *   to the writer: to be measured on the first pass, to be written on
+ *   the second
+ *
+ * Returns: the number of lines
+ */
+static long log_pass(const char *buf, size_t len, FILE *times,
+                     order_log_writer_t *w, bool measure) {
+    order_msg_t msgs[PARSE_LINES];
+    enum parse_status statuses[PARSE_LINES];
+    long line = 0;
+    size_t used = 0;
+    while (used < len) {
+        int n;
+        used += parse_order_batch(buf + used, len - used, true, msgs,
+                                  statuses, PARSE_LINES, &n);
+        for (int i = 0; i < n; i++, line++) {
+            int time = next_time(times, line);
+            if (!measure) {
+                order_log_add(w, &msgs[i], statuses[i], time);
+                continue;
+            }
+            if (statuses[i] != PARSE_OK) {
+                fprintf(stderr, "ordlog: line %ld: %s\n", line + 1,
+                        parse_status_str(statuses[i]));
+            }
+            order_log_measure(w, &msgs[i], statuses[i], time);
+        }
+    }
+    return line;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3 && argc != 4) {
+        fprintf(stderr, "usage: ordlog <orders file> <order log> "
+                "[times file]\n");
+        fprintf(stderr, "  Use - to read the orders from stdin.\n");
+        exit(1);
+    }
+    FILE *stdin_copy = NULL;
+    int in;
+    if (strcmp(argv[1], "-") == 0) {
+        stdin_copy = copy_stdin();
+        in = fileno(stdin_copy);
+    } else {
+        in = open(argv[1], O_RDONLY);
+        if (in < 0) {
+            fprintf(stderr, "ordlog: cannot open %s\n", argv[1]);
+            exit(1);
+        }
+    }
+    size_t len;
+    char *buf = map_file(in, &len);
+
+    FILE *times = NULL;
+    long num_times = -1;
+    if (argc == 4) {
+        times = open_times(argv[3], &num_times);
+    }
+    order_log_writer_t *w = mk_order_log_writer();
+    long num_lines = log_pass(buf, len, times, w, true);
+    if (times != NULL && num_times != num_lines) {
+        fprintf(stderr, "ordlog: %ld times for %ld orders\n", num_times,
+                num_lines);
+        exit(1);
+    }
+
+    int out = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        fprintf(stderr, "ordlog: cannot write %s\n", argv[2]);
+        exit(1);
+    }
+    if (times != NULL) {
+        fclose(times);
+        times = open_times(argv[3], &num_times);
+    }
+    start_order_log(w, out);
+    log_pass(buf, len, times, w, false);
+    finish_order_log(w);
+    close(out);
+    free_order_log_writer(w);
+    if (times != NULL) {
+        fclose(times);
+    }
+    if (buf != NULL) {
+        munmap(buf, len);
+    }
+    if (stdin_copy != NULL) {
+        fclose(stdin_copy);
+    } else {
+        close(in);
+    }
+    return 0;
+}
@@ -0,0 +1,156 @@
+/*
+ * CS 152, Spring 2022
+ * Oref Index Implementation
+ *
+ * Separate chaining through the orders' hnext field, so indexing an order
+ * never allocates. The bucket array doubles when the index gets as many
+ * orders as buckets, which keeps the chains short.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "order.h"
+#include "oref_index.h"
+#include "util.h"
+
+struct oref_index {
+    int num_orders;        // number of orders indexed
+    int bits;              // log2 of the number of buckets
+    order_t **buckets;     // chains of orders, oldest first
+};
+
+#define INIT_BITS 6
+
+/*
+ * bucket_of: Picks the bucket for an oref. Multiplicative hashing keeps
+ * runs of consecutive orefs spread over the buckets.
+ *
+ * Returns: bucket index in [0, 2^bits)
+ */
+static unsigned long bucket_of(long long oref, int bits) {
+    unsigned long long h = (unsigned long long) oref * 0x9E3779B97F4A7C15ULL;
+    return (unsigned long) (h >> (64 - bits));
+}
+
+/*
+ * mk_buckets: allocates an array of 2^bits empty buckets
+ */
+static order_t **mk_buckets(int bits) {
+    unsigned long n = 1UL << bits;
+    order_t **buckets = (order_t **) ck_malloc(sizeof(order_t*) * n,
+                                               "mk_buckets");
+    for (unsigned long i = 0; i < n; i++) {
+        buckets[i] = NULL;
+    }
+    return buckets;
+}
+
+/*
+ * mk_oref_index: Creates a new empty index
+ *
+ * Returns: an empty index
+ */
+oref_index_t *mk_oref_index() {
+    oref_index_t *index = (oref_index_t *) ck_malloc(sizeof(oref_index_t),
+                                                     "mk_oref_index");
+    index->num_orders = 0;
+    index->bits = INIT_BITS;
+    index->buckets = mk_buckets(INIT_BITS);
+    return index;
+}
+
+/*
+ * free_oref_index: Frees an index. The indexed orders are not freed.
+ *
+ * index: the index to free
+ */
+void free_oref_index(oref_index_t *index) {
+    ck_free(index->buckets);
+    ck_free(index);
+}
+
+/*
+ * append_to_chain: adds an order to the end of a bucket's chain so
+ * orders with the same oref are found oldest first
+ */
+static void append_to_chain(order_t **bucket, order_t *order) {
+    order->hnext = NULL;
+    while (*bucket != NULL) {
+        bucket = &(*bucket)->hnext;
+    }
+    *bucket = order;
+}
+
+/*
+ * grow: doubles the number of buckets and moves every order over
+ */
+static void grow(oref_index_t *index) {
+    int new_bits = index->bits + 1;
+    order_t **new_buckets = mk_buckets(new_bits);
+    unsigned long n = 1UL << index->bits;
+    for (unsigned long i = 0; i < n; i++) {
+        order_t *curr = index->buckets[i];
+        while (curr != NULL) {
+            order_t *next = curr->hnext;
+            append_to_chain(&new_buckets[bucket_of(curr->oref, new_bits)],
+                            curr);
+            curr = next;
+        }
+    }
+    ck_free(index->buckets);
+    index->buckets = new_buckets;
+    index->bits = new_bits;
+}
+
+/*
+ * index_order: Adds an order to the index. Grows the index as needed.
+ *
+ * index: the index
+ * order: the order to add (must not already be in an index)
+ */
+void index_order(oref_index_t *index, order_t *order) {
+    assert(order != NULL);
+    if (index->num_orders >= (1L << index->bits)) {
+        grow(index);
+    }
+    append_to_chain(&index->buckets[bucket_of(order->oref, index->bits)],
+                    order);
+    index->num_orders++;
+}
+
+/*
+ * unindex_order: Removes an order from the index
+ *
+ * index: the index
+ * order: the order to remove (must be in the index)
+ */
+void unindex_order(oref_index_t *index, order_t *order) {
+    order_t **link = &index->buckets[bucket_of(order->oref, index->bits)];
+    while (*link != order) {
+        assert(*link != NULL);
+        link = &(*link)->hnext;
+    }
+    *link = order->hnext;
+    order->hnext = NULL;
+    index->num_orders--;
+}
+
+/*
+ * lookup_oref: Finds an indexed order by oref. If more than one order
+ * with the oref is indexed, the one that was indexed first is returned.
+ *
+ * index: the index
+ * oref: the oref to look for
+ *
+ * Returns: the order, or NULL if no order with that oref is indexed
+ */
+order_t *lookup_oref(oref_index_t *index, long long oref) {
+    order_t *curr = index->buckets[bucket_of(oref, index->bits)];
+    while (curr != NULL && curr->oref != oref) {
+        curr = curr->hnext;
+    }
+    return curr;
+}
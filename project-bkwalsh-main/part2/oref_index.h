@@ -0,0 +1,56 @@
+/*
+ * CS 152, Spring 2022
+ * Oref Index Interface.
+ *
+ * A hash index from oref to the resting order with that oref, so a book
+ * can find the target of a cancel without walking every order.
+ */
+
+#ifndef OREF_INDEX_H
+#define OREF_INDEX_H
+
+/* The index type is opaque */
+typedef struct oref_index oref_index_t;
+
+/*
+ * mk_oref_index: Creates a new empty index
+ *
+ * Returns: an empty index
+ */
+oref_index_t *mk_oref_index();
+
+/*
+ * free_oref_index: Frees an index. The indexed orders are not freed.
+ *
+ * index: the index to free
+ */
+void free_oref_index(oref_index_t *index);
+
+/*
+ * index_order: Adds an order to the index. Grows the index as needed.
+ *
+ * index: the index
+ * order: the order to add (must not already be in an index)
+ */
+void index_order(oref_index_t *index, order_t *order);
+
+/*
+ * unindex_order: Removes an order from the index
+ *
+ * index: the index
+ * order: the order to remove (must be in the index)
+ */
+void unindex_order(oref_index_t *index, order_t *order);
+
+/*
+ * lookup_oref: Finds an indexed order by oref. If more than one order
+ * with the oref is indexed, the one that was indexed first is returned.
+ *
+ * index: the index
+ * oref: the oref to look for
+ *
+ * Returns: the order, or NULL if no order with that oref is indexed
+ */
+order_t *lookup_oref(oref_index_t *index, long long oref);
+
+#endif
@@ -0,0 +1,432 @@
+/*
+ * CS 152, Spring 2022
+ * Sharded Matching
+ *
+ * Ticker id s goes to worker s % num_shards. The submitting thread makes
+ * each exchange the first time its ticker appears, before the ticker's
+ * first order goes on a ring, and frees the exchanges once the workers
+ * have stopped. In between only the worker touches the exchange and the
+ * worker's order pool.
+ *
+ * Each worker writes its actions to its own temporary file as a binary
+ * action log. Since orders reach a worker in submission order, each file
+ * is sorted by order index and shard_write_actions merges them, reading
+ * fixed size records rather than lines.
+ */
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "order.h"
+#include "order_pool.h"
+#include "symbols.h"
+#include "action_report.h"
+#include "action_log.h"
+#include "action_writer.h"
+#include "exchange.h"
+#include "latency.h"
+#include "shard.h"
+#include "util.h"
+
+#define RING_SLOTS 4096         // must be a power of two
+#define SPIN_LIMIT 128
+#define INIT_EXCHANGES 64
+#define CACHE_LINE 64
+
+/* an order on its way to a worker; a NULL exchange tells the worker to
+ * stop */
+typedef struct shard_msg {
+    order_msg_t msg;
+    exchange_t *exchange;
+    int index;                  // where the actions go in the output
+    int time;
+} shard_msg_t;
+
+/* single-producer/single-consumer ring. head and tail count up forever
+ * and are masked to find the slot. Each index lives on its own cache
+ * line, next to the other side's last seen value of it. */
+typedef struct ring {
+    _Alignas(CACHE_LINE) atomic_size_t tail;   // written by the producer
+    size_t head_seen;                          // producer's copy of head
+    _Alignas(CACHE_LINE) atomic_size_t head;   // written by the worker
+    size_t tail_seen;                          // worker's copy of tail
+    _Alignas(CACHE_LINE) shard_msg_t slots[RING_SLOTS];
+} ring_t;
+
+typedef struct shard {
+    ring_t ring;
+    pthread_t thread;
+    order_pool_t *pool;         // orders for this worker's exchanges
+    FILE *out;                  // this worker's actions
+    latency_stats_t *latency;   // this worker's timings, NULL if none
+    int cpu;                    // CPU to pin to, -1 for none
+} shard_t;
+
+struct shard_set {
+    shard_t *shards;
+    int num_shards;
+    exchange_t **by_symbol;     // indexed by ticker id, NULL if none yet
+    int num_slots;
+    bool finished;
+};
+
+/*
+ * backoff: wait a little before looking at a ring again. Spins first,
+ *  then gives up the CPU so a worker sharing it can run.
+ *
+ * spins: number of times the caller has waited so far
+ */
+static void backoff(int *spins) {
+    if (*spins < SPIN_LIMIT) {
+        (*spins)++;
+    } else {
+        sched_yield();
+    }
+}
+
+/*
+ * ring_push: add a message to a ring, waiting while it is full
+ */
+static void ring_push(ring_t *ring, shard_msg_t *msg) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    int spins = 0;
+    while (tail - ring->head_seen == RING_SLOTS) {
+        ring->head_seen = atomic_load_explicit(&ring->head,
+                                               memory_order_acquire);
+        if (tail - ring->head_seen == RING_SLOTS) {
+            backoff(&spins);
+        }
+    }
+    ring->slots[tail & (RING_SLOTS - 1)] = *msg;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+/*
+ * ring_pop: take the next message off a ring, waiting while it is empty
+ */
+static void ring_pop(ring_t *ring, shard_msg_t *msg) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    int spins = 0;
+    while (head == ring->tail_seen) {
+        ring->tail_seen = atomic_load_explicit(&ring->tail,
+                                               memory_order_acquire);
+        if (head == ring->tail_seen) {
+            backoff(&spins);
+        }
+    }
+    *msg = ring->slots[head & (RING_SLOTS - 1)];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+/*
+ * run_shard: worker loop. Matches orders until told to stop.
+ *
+ * arg: the worker's shard_t
+ */
+static void *run_shard(void *arg) {
+    shard_t *shard = (shard_t *) arg;
+#ifdef __linux__
+    if (shard->cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(shard->cpu, &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) {
+            fprintf(stderr, "run_shard: cannot pin to CPU %d\n", shard->cpu);
+        }
+    }
+#endif
+    shard_msg_t msg;
+    action_report_t *ar = mk_action_report("");
+    action_writer_t *writer = mk_action_log_writer(fileno(shard->out));
+    while (true) {
+        ring_pop(&shard->ring, &msg);
+        if (msg.exchange == NULL) {
+            free_action_writer(writer);
+            free_action_report(ar);
+            return NULL;
+        }
+        process_order_msg_into(msg.exchange, &msg.msg, msg.time, ar);
+        writer_add_report(writer, ar, msg.index);
+    }
+}
+
+/*
+ * mk_shard_set: make a shard set and start its workers
+ *
+ * num_shards: number of worker threads
+ * pin: pin worker i to CPU i (modulo the number of CPUs)
+ *
+ * Returns: a shard set
+ */
+shard_set_t *mk_shard_set(int num_shards, bool pin) {
+    assert(num_shards > 0);
+    shard_set_t *set = (shard_set_t *) ck_malloc(sizeof(shard_set_t),
+                                                 "mk_shard_set");
+    set->shards = (shard_t *) aligned_alloc(CACHE_LINE,
+                                            sizeof(shard_t) * num_shards);
+    if (set->shards == NULL) {
+        fprintf(stderr, "mk_shard_set: Unable to allocate\n");
+        exit(1);
+    }
+    set->num_shards = num_shards;
+    set->by_symbol = (exchange_t **) ck_malloc(sizeof(exchange_t *) *
+                                               INIT_EXCHANGES,
+                                               "mk_shard_set");
+    for (int i = 0; i < INIT_EXCHANGES; i++) {
+        set->by_symbol[i] = NULL;
+    }
+    set->num_slots = INIT_EXCHANGES;
+    set->finished = false;
+
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 0; i < num_shards; i++) {
+        shard_t *shard = &set->shards[i];
+        atomic_init(&shard->ring.head, 0);
+        atomic_init(&shard->ring.tail, 0);
+        shard->ring.head_seen = 0;
+        shard->ring.tail_seen = 0;
+        shard->pool = mk_order_pool();
+        shard->out = tmpfile();
+        if (shard->out == NULL) {
+            fprintf(stderr, "mk_shard_set: cannot make a temporary file\n");
+            exit(1);
+        }
+        shard->latency = NULL;
+        shard->cpu = (pin && num_cpus > 0) ? (int) (i % num_cpus) : -1;
+        if (pthread_create(&shard->thread, NULL, run_shard, shard)) {
+            fprintf(stderr, "mk_shard_set: cannot start a worker\n");
+            exit(1);
+        }
+    }
+    return set;
+}
+
+/*
+ * get_exchange: find the exchange for a ticker id, making it on the
+ *  ticker's worker's pool if needed
+ */
+static exchange_t *get_exchange(shard_set_t *set, int symbol) {
+    if (symbol >= set->num_slots) {
+        int new_num_slots = set->num_slots;
+        while (symbol >= new_num_slots) {
+            new_num_slots *= 2;
+        }
+        set->by_symbol = (exchange_t **)
+            ck_realloc(set->by_symbol, sizeof(exchange_t *) * new_num_slots,
+                       "get_exchange");
+        for (int i = set->num_slots; i < new_num_slots; i++) {
+            set->by_symbol[i] = NULL;
+        }
+        set->num_slots = new_num_slots;
+    }
+    exchange_t *exchange = set->by_symbol[symbol];
+    if (exchange == NULL) {
+        shard_t *shard = &set->shards[symbol % set->num_shards];
+        exchange = mk_exchange_in(symbol, shard->pool);
+        exchange_track_latency(exchange, shard->latency);
+        set->by_symbol[symbol] = exchange;
+    }
+    return exchange;
+}
+
+/*
+ * shard_submit_order: parse an order and pass it to the worker for its
+ *   ticker
+ *
+ * set: a shard set
+ * ord_str: a string describing the order (in the expected format)
+ * time: the time the order was placed
+ */
+void shard_submit_order(shard_set_t *set, char *ord_str, int time) {
+    assert(ord_str != NULL);
+    order_msg_t msg;
+    enum parse_status status = parse_order_line(ord_str, &msg);
+    if (status != PARSE_OK) {
+        fprintf(stderr, "shard_submit_order: %s: %s\n",
+                parse_status_str(status), ord_str);
+        return;
+    }
+    shard_submit_msg(set, &msg, time);
+}
+
+/*
+ * shard_submit_msg: pass an order that has already been parsed to the
+ *   worker for its ticker
+ *
+ * set: a shard set
+ * msg: the fields of the order
+ * time: the time the order was placed
+ */
+void shard_submit_msg(shard_set_t *set, order_msg_t *msg, int time) {
+    shard_submit_msg_at(set, msg, time, time);
+}
+
+/*
+ * shard_submit_msg_at: like shard_submit_msg, for an order whose time
+ *   is not its index in the output
+ *
+ * set: a shard set
+ * msg: the fields of the order
+ * index: the index of the order's actions in the output
+ * time: the time the order was placed
+ */
+void shard_submit_msg_at(shard_set_t *set, order_msg_t *msg, int index,
+                         int time) {
+    assert(set != NULL && !set->finished);
+    assert(msg != NULL);
+    if (msg->symbol < 0 || msg->symbol >= num_symbols()) {
+        fprintf(stderr, "shard_submit_msg: %s: oref %lld\n",
+                parse_status_str(PARSE_BAD_TICKER), msg->oref);
+        return;
+    }
+    shard_msg_t out;
+    out.msg = *msg;
+    out.exchange = get_exchange(set, msg->symbol);
+    out.index = index;
+    out.time = time;
+    ring_push(&set->shards[msg->symbol % set->num_shards].ring, &out);
+}
+
+/*
+ * shard_finish: wait for the workers to match every submitted order and
+ *   stop them
+ *
+ * set: a shard set
+ */
+void shard_finish(shard_set_t *set) {
+    if (set->finished) {
+        return;
+    }
+    shard_msg_t stop;
+    memset(&stop, 0, sizeof(stop));
+    for (int i = 0; i < set->num_shards; i++) {
+        ring_push(&set->shards[i].ring, &stop);
+    }
+    for (int i = 0; i < set->num_shards; i++) {
+        pthread_join(set->shards[i].thread, NULL);
+    }
+    set->finished = true;
+}
+
+/*
+ * next_action: read the next record from a worker's file
+ *
+ * rec: out parameter, the action
+ *
+ * Returns: false at the end of the file
+ */
+static bool next_action(FILE *fp, action_record_t *rec) {
+    unsigned char buf[ACTION_LOG_RECORD_LEN];
+    if (fread(buf, ACTION_LOG_RECORD_LEN, 1, fp) != 1) {
+        return false;
+    }
+    if (!decode_action_record(buf, rec)) {
+        fprintf(stderr, "shard_write_actions: bad action record\n");
+        exit(1);
+    }
+    return true;
+}
+
+/*
+ * shard_write_actions: write the actions for every order, merged into
+ *   submission order
+ *
+ * set: a shard set
+ * w: the writer to add the actions to
+ */
+void shard_write_actions(shard_set_t *set, action_writer_t *w) {
+    shard_finish(set);
+    int n = set->num_shards;
+    action_record_t *recs = (action_record_t *)
+        ck_malloc(sizeof(action_record_t) * n, "shard_write_actions");
+    bool *more = (bool *) ck_malloc(sizeof(bool) * n, "shard_write_actions");
+    for (int i = 0; i < n; i++) {
+        FILE *fp = set->shards[i].out;
+        fseek(fp, ACTION_LOG_MAGIC_LEN, SEEK_SET);
+        more[i] = next_action(fp, &recs[i]);
+    }
+    while (true) {
+        // few workers, so a linear scan for the smallest index will do
+        int min = -1;
+        for (int i = 0; i < n; i++) {
+            if (more[i] && (min < 0 || recs[i].index < recs[min].index)) {
+                min = i;
+            }
+        }
+        if (min < 0) {
+            break;
+        }
+        action_record_t *rec = &recs[min];
+        writer_add_action(w, rec->index, rec->action, rec->oref, rec->price,
+                          rec->shares);
+        more[min] = next_action(set->shards[min].out, rec);
+    }
+    ck_free(recs);
+    ck_free(more);
+}
+
+/*
+ * shard_track_latency: time the orders the workers process. Each
+ *   worker records into its own histograms.
+ *
+ * set: a shard set that has not had any orders yet
+ * sample_every: time one order in this many
+ */
+void shard_track_latency(shard_set_t *set, int sample_every) {
+    for (int i = 0; i < set->num_slots; i++) {
+        assert(set->by_symbol[i] == NULL);
+    }
+    for (int i = 0; i < set->num_shards; i++) {
+        if (set->shards[i].latency == NULL) {
+            set->shards[i].latency = mk_latency_stats(sample_every);
+        }
+    }
+}
+
+/*
+ * shard_latency: add the workers' timings to a set of histograms
+ *
+ * set: a shard set
+ * into: the histograms to add to
+ */
+void shard_latency(shard_set_t *set, latency_stats_t *into) {
+    shard_finish(set);
+    for (int i = 0; i < set->num_shards; i++) {
+        if (set->shards[i].latency != NULL) {
+            latency_merge(into, set->shards[i].latency);
+        }
+    }
+}
+
+/*
+ * free_shard_set: free a shard set and its exchanges
+ *
+ * set: a shard set
+ */
+void free_shard_set(shard_set_t *set) {
+    shard_finish(set);
+    for (int i = 0; i < set->num_slots; i++) {
+        if (set->by_symbol[i] != NULL) {
+            free_exchange(set->by_symbol[i]);
+        }
+    }
+    for (int i = 0; i < set->num_shards; i++) {
+        free_order_pool(set->shards[i].pool);
+        fclose(set->shards[i].out);
+        if (set->shards[i].latency != NULL) {
+            free_latency_stats(set->shards[i].latency);
+        }
+    }
+    free(set->shards);
+    ck_free(set->by_symbol);
+    ck_free(set);
+}
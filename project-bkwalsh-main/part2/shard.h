@@ -0,0 +1,117 @@
+/*
+ * CS 152, Spring 2022
+ * Sharded Matching Interface.
+ *
+ * A shard set spreads tickers over worker threads. Each worker owns the
+ * exchanges for its tickers and matches their orders on its own, so
+ * tickers on different workers are matched in parallel. The thread that
+ * submits orders parses them, picks the worker for the ticker and hands
+ * the order over on that worker's single-producer/single-consumer ring.
+ *
+ * Every ticker's orders are matched by one worker in the order they were
+ * submitted, so each ticker's actions are the same as in a serial run.
+ * shard_write_actions merges the workers' actions back into submission
+ * order, which makes the whole output match the serial run too.
+ *
+ * Only one thread may submit orders to a shard set.
+ */
+
+#ifndef SHARD_H
+#define SHARD_H
+
+/* The type for a shard set.  This type is opaque */
+typedef struct shard_set shard_set_t;
+
+struct order_msg;
+struct action_writer;
+struct latency_stats;
+
+/*
+ * mk_shard_set: make a shard set and start its workers
+ *
+ * num_shards: number of worker threads
+ * pin: pin worker i to CPU i (modulo the number of CPUs)
+ *
+ * Returns: a shard set
+ */
+shard_set_t *mk_shard_set(int num_shards, bool pin);
+
+/*
+ * shard_submit_order: parse an order and pass it to the worker for its
+ *   ticker. Waits while that worker's ring is full. A line that does not
+ *   parse is reported on stderr and dropped.
+ *
+ * set: a shard set
+ * ord_str: a string describing the order (in the expected format)
+ * time: the time the order was placed. Times must increase, and the
+ *   time is the index of the order's actions in the output.
+ */
+void shard_submit_order(shard_set_t *set, char *ord_str, int time);
+
+/*
+ * shard_submit_msg: pass an order that has already been parsed to the
+ *   worker for its ticker
+ *
+ * set: a shard set
+ * msg: the fields of the order (see order.h)
+ * time: the time the order was placed, as for shard_submit_order
+ */
+void shard_submit_msg(shard_set_t *set, struct order_msg *msg, int time);
+
+/*
+ * shard_submit_msg_at: like shard_submit_msg, for an order whose time
+ *   is not its index in the output
+ *
+ * set: a shard set
+ * msg: the fields of the order (see order.h)
+ * index: the index of the order's actions in the output. Indexes must
+ *   increase.
+ * time: the time the order was placed
+ */
+void shard_submit_msg_at(shard_set_t *set, struct order_msg *msg, int index,
+                         int time);
+
+/*
+ * shard_finish: wait for the workers to match every submitted order and
+ *   stop them. No orders may be submitted afterwards.
+ *
+ * set: a shard set
+ */
+void shard_finish(shard_set_t *set);
+
+/*
+ * shard_write_actions: add the actions for every order to a writer,
+ *   merged into submission order. Calls shard_finish first if needed.
+ *
+ * set: a shard set
+ * w: an action writer, text or binary log
+ */
+void shard_write_actions(shard_set_t *set, struct action_writer *w);
+
+/*
+ * shard_track_latency: time the orders the workers process (see
+ *   latency.h). Call before submitting any orders.
+ *
+ * set: a shard set
+ * sample_every: time one order in this many
+ */
+void shard_track_latency(shard_set_t *set, int sample_every);
+
+/*
+ * shard_latency: add the workers' timings to a set of histograms. Calls
+ *   shard_finish first if needed.
+ *
+ * set: a shard set
+ * into: the histograms to add to
+ */
+void shard_latency(shard_set_t *set, struct latency_stats *into);
+
+/*
+ * free_shard_set: free a shard set and its exchanges. Calls
+ *   shard_finish first if needed.
+ *
+ * set: a shard set
+ */
+void free_shard_set(shard_set_t *set);
+
+#endif
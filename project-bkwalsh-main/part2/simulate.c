@@ -11,64 +11,499 @@
  * People consulted: None
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
 #include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
+#include "order.h"
+#include "batch_parse.h"
+#include "book.h"
+#include "order_log.h"
+#include "bqueue.h"
 #include "action_report.h"
+#include "action_writer.h"
 #include "exchange.h"
+#include "latency.h"
+#include "market.h"
+#include "shard.h"
+#include "trace.h"
+#include "util.h"
+
+#define MAX_TEST_FILENAME 64
+#define BATCH_LINES 1024        // orders passed between stages at once
+#define NUM_BATCHES 8           // batches in flight between two stages
+#define READ_CHUNK (4 << 20)
+
+/*
+ * The simulation runs as a pipeline of three threads:
+ *
+ *   reader:  maps the order file into memory, or reads it in large
+ *            chunks if it is a pipe, and parses it with parse_order_batch.
+ *            A binary order log (order_log.h) is read in place instead.
+ *   matcher: runs the parsed orders through the exchange (this thread)
+ *   writer:  formats the action reports with an action_writer, which
+ *            hands them to the kernel in large blocks, as text or as a
+ *            binary action log (action_log.h)
+ *
+ * Batches of orders and of reports go between the stages on bounded
+ * queues, and empty batches come back on a second queue for reuse. The
+ * reports in a batch are reset and refilled each time round, so memory
+ * stays fixed however long the file is and matching does not allocate
+ * reports. The matcher never does
+ * any file I/O. A NULL batch marks the end of the orders.
+ */
 
-#define MAX_ORDER_LEN 1000
-#define MAX_TEST_FILENAME 30
+typedef struct order_batch {
+	int first;                              // index of the first line
+	int count;
+	order_msg_t msgs[BATCH_LINES];
+	enum parse_status statuses[BATCH_LINES];
+	int times[BATCH_LINES];
+} order_batch_t;
 
-// Your helper functions go here.
+typedef struct report_batch {
+	int first;                              // index of the first line
+	int count;
+	action_report_t *reports[BATCH_LINES];  // reused for every batch
+} report_batch_t;
 
-void query(FILE *test, exchange_t *exchange, char *ticker, int order_num) {
+typedef struct pipeline {
+	int in;                 // file descriptor of the orders
 	FILE *out;
-	int c;
-	int clock=0;
-	bool flag=false;
-	int i=0;
-	char buffer[25];
-	char out_string[25];
-	sprintf(out_string, "tests/test%d_actions.csv", order_num);
-	out = fopen(out_string,"w"); 
-	action_report_t *ar=mk_action_report(ticker);
-	while(flag!=true){
-		c = fgetc(test);
-		buffer[i] = c;	
-		++i;
-		if (c == '\n' || (c == EOF && c != '\n' &&  i != 1)) {
-			buffer[i]='\0';
-			ar = process_order(exchange,buffer,clock);
-			write_action_report_to_file(ar, out, clock);
-			clock++;
-			i = 0;
-		}
-		if (c == EOF){
-			flag = true;
-		} 
-	}
-	fclose(out);
+	action_writer_t *writer;    // writes to out's file descriptor
+	exchange_t *exchange;   // the engine; exactly one of these is not NULL
+	market_t *market;
+	shard_set_t *shards;
+	bqueue_t *parsed;       // order batches, reader to matcher
+	bqueue_t *free_orders;  // empty order batches, back to the reader
+	bqueue_t *matched;      // report batches, matcher to writer
+	bqueue_t *free_reports; // empty report batches, back to the matcher
+} pipeline_t;
+
+/*
+ * push_batch: pass a full batch to the matcher and start the next one
+ */
+order_batch_t *push_batch(pipeline_t *p, order_batch_t *b) {
+	bqueue_push(p->parsed, b);
+	int next = b->first + b->count;
+	b = (order_batch_t *) bqueue_pop(p->free_orders);
+	b->first = next;
+	b->count = 0;
+	return b;
 }
 
-int main(int argc, char **argv) {
-	if (argc!=3){
-		fprintf(stderr,"usage: simulate <ticker symbol> <test number> \n");
+/*
+ * parse_lines: parse the complete lines at the start of buf into order
+ *  batches, passing each batch to the matcher as it fills. A line that
+ *  does not parse still takes up an entry so line numbers stay in step
+ *  with the serial simulation.
+ *
+ * final: buf runs to the end of the input
+ * batch: in/out parameter, the batch being filled
+ *
+ * Returns: the number of bytes of buf used
+ */
+size_t parse_lines(pipeline_t *p, const char *buf, size_t len, bool final,
+                   order_batch_t **batch) {
+	order_batch_t *b = *batch;
+	size_t used = 0;
+	while (true) {
+		int n;
+		used += parse_order_batch(buf + used, len - used, final,
+			&b->msgs[b->count], &b->statuses[b->count],
+			BATCH_LINES - b->count, &n);
+		for (int i = b->count; i < b->count + n; i++) {
+			b->times[i] = b->first + i;
+			if (b->statuses[i] != PARSE_OK) {
+				fprintf(stderr, "simulate: line %d: %s\n",
+					b->first + i + 1, parse_status_str(b->statuses[i]));
+			}
+		}
+		b->count += n;
+		if (b->count < BATCH_LINES) {
+			break;
+		}
+		b = push_batch(p, b);
+	}
+	*batch = b;
+	return used;
+}
+
+/*
+ * read_order_log: fill order batches from a binary order log, taking
+ *  the times from the log. Lines that did not parse when the log was
+ *  made were reported then and are skipped.
+ */
+void read_order_log(pipeline_t *p, const char *map, size_t len,
+                    order_batch_t **batch) {
+	order_log_t *log = open_order_log(map, len);
+	if (log == NULL) {
 		exit(1);
 	}
-	int order_num = atoi(argv[2]);
-	FILE *order_stack;
-	char buffer[25];
-	sprintf(buffer, "tests/test%d_orders.csv", order_num);
-	order_stack = fopen(buffer,"r");
-	if(order_stack == NULL){
-		fprintf(stderr,"usage: invalid file number \n");
+	order_batch_t *b = *batch;
+	long num_orders = order_log_length(log);
+	for (long i = 0; i < num_orders; i++) {
+		b->statuses[b->count] = order_log_msg(log, i, &b->msgs[b->count],
+			&b->times[b->count]);
+		b->count++;
+		if (b->count == BATCH_LINES) {
+			b = push_batch(p, b);
+		}
+	}
+	free_order_log(log);
+	*batch = b;
+}
+
+/*
+ * map_orders: parse a regular file by mapping it into memory, so the
+ *  lines are parsed where the kernel put them with no copying
+ *
+ * Returns: false if the input cannot be mapped
+ */
+bool map_orders(pipeline_t *p, order_batch_t **batch) {
+	struct stat st;
+	if (fstat(p->in, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+		return false;
+	}
+	char *map = (char *) mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+		p->in, 0);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+	posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+	if (is_order_log(map, st.st_size)) {
+		read_order_log(p, map, st.st_size, batch);
+	} else {
+		parse_lines(p, map, st.st_size, true, batch);
+	}
+	munmap(map, st.st_size);
+	return true;
+}
+
+/*
+ * stream_orders: parse input that cannot be mapped, such as a pipe, by
+ *  reading it in large chunks. A partial line at the end of a chunk is
+ *  moved to the front of the buffer, and the buffer grows if a single
+ *  line does not fit, so lines can be any length.
+ */
+void stream_orders(pipeline_t *p, order_batch_t **batch) {
+	size_t buf_size = READ_CHUNK;
+	char *buf = (char *) ck_malloc(buf_size, "stream_orders");
+	size_t len = 0;
+	bool eof = false;
+	bool checked = false;   // looked for an order log's magic
+	while (!eof) {
+		if (len == buf_size) {
+			buf_size *= 2;
+			buf = (char *) ck_realloc(buf, buf_size, "stream_orders");
+		}
+		ssize_t got = read(p->in, buf + len, buf_size - len);
+		if (got < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("simulate: read");
+			exit(1);
+		}
+		len += got;
+		eof = got == 0;
+		if (!checked && (len >= ORDER_LOG_MAGIC_LEN || eof)) {
+			checked = true;
+			if (is_order_log(buf, len)) {
+				fprintf(stderr, "simulate: an order log must be "
+					"given as a file, not a pipe\n");
+				exit(1);
+			}
+		}
+		size_t used = parse_lines(p, buf, len, eof, batch);
+		memmove(buf, buf + used, len - used);
+		len -= used;
+	}
+	ck_free(buf);
+}
+
+/*
+ * read_orders: reader stage. Parses every line of the input into order
+ *  batches and ends the stream with NULL.
+ */
+void *read_orders(void *arg) {
+	pipeline_t *p = (pipeline_t *) arg;
+	order_batch_t *batch = (order_batch_t *) bqueue_pop(p->free_orders);
+	batch->first = 0;
+	batch->count = 0;
+	if (!map_orders(p, &batch)) {
+		stream_orders(p, &batch);
+	}
+	if (batch->count > 0) {
+		bqueue_push(p->parsed, batch);
+	} else {
+		bqueue_push(p->free_orders, batch);
+	}
+	bqueue_push(p->parsed, NULL);
+	return NULL;
+}
+
+/*
+ * write_reports: writer stage. Writes each report in a batch to the
+ *  output file and frees it.
+ */
+void *write_reports(void *arg) {
+	pipeline_t *p = (pipeline_t *) arg;
+	report_batch_t *batch;
+	while ((batch = (report_batch_t *) bqueue_pop(p->matched)) != NULL) {
+		for (int i = 0; i < batch->count; i++) {
+			writer_add_report(p->writer, batch->reports[i],
+				batch->first + i);
+		}
+		bqueue_push(p->free_reports, batch);
+	}
+	return NULL;
+}
+
+/*
+ * match_orders: matcher stage. Runs each parsed order through the
+ *  engine at the time the reader gave it.
+ */
+void match_orders(pipeline_t *p) {
+	order_batch_t *batch;
+	while ((batch = (order_batch_t *) bqueue_pop(p->parsed)) != NULL) {
+		report_batch_t *out = (report_batch_t *) bqueue_pop(p->free_reports);
+		out->first = batch->first;
+		out->count = batch->count;
+		for (int i = 0; i < batch->count; i++) {
+			int clock = batch->times[i];
+			action_report_t *ar = out->reports[i];
+			if (batch->statuses[i] != PARSE_OK) {
+				// reported by the reader
+				reset_action_report(ar, "");
+			} else if (p->shards != NULL) {
+				// the shard set keeps the actions until the end
+				shard_submit_msg_at(p->shards, &batch->msgs[i],
+					batch->first + i, clock);
+				reset_action_report(ar, "");
+			} else if (p->exchange != NULL) {
+				process_order_msg_into(p->exchange, &batch->msgs[i], clock,
+					ar);
+			} else {
+				market_process_msg_into(p->market, &batch->msgs[i], clock,
+					ar);
+			}
+		}
+		bqueue_push(p->free_orders, batch);
+		bqueue_push(p->matched, out);
+	}
+	bqueue_push(p->matched, NULL);
+}
+
+/*
+ * query: run every order from in through an exchange, a market or a
+ *  shard set (whichever is not NULL), and write the actions to out, as a
+ *  binary action log if binary is set
+ */
+void query(int in, FILE *out, bool binary, exchange_t *exchange,
+           market_t *market, shard_set_t *shards) {
+	pipeline_t p;
+	p.in = in;
+	p.out = out;
+	fflush(out);
+	if (binary) {
+		p.writer = mk_action_log_writer(fileno(out));
+	} else {
+		p.writer = mk_action_writer(fileno(out));
+	}
+	p.exchange = exchange;
+	p.market = market;
+	p.shards = shards;
+	p.parsed = mk_bqueue(NUM_BATCHES + 1);
+	p.free_orders = mk_bqueue(NUM_BATCHES);
+	p.matched = mk_bqueue(NUM_BATCHES + 1);
+	p.free_reports = mk_bqueue(NUM_BATCHES);
+	for (int i = 0; i < NUM_BATCHES; i++) {
+		bqueue_push(p.free_orders, ck_malloc(sizeof(order_batch_t), "query"));
+		report_batch_t *reports = (report_batch_t *)
+			ck_malloc(sizeof(report_batch_t), "query");
+		for (int j = 0; j < BATCH_LINES; j++) {
+			reports->reports[j] = mk_action_report("");
+		}
+		bqueue_push(p.free_reports, reports);
+	}
+
+	pthread_t reader, writer;
+	if (pthread_create(&reader, NULL, read_orders, &p) ||
+	    pthread_create(&writer, NULL, write_reports, &p)) {
+		fprintf(stderr, "simulate: cannot start threads\n");
 		exit(1);
 	}
-	exchange_t *exchange = mk_exchange(argv[1]);
-	query(order_stack, exchange, argv[1],order_num);
-	fclose(order_stack);
+	match_orders(&p);
+	pthread_join(reader, NULL);
+	pthread_join(writer, NULL);
+	if (shards != NULL) {
+		shard_write_actions(shards, p.writer);
+	}
+	free_action_writer(p.writer);
+
+	for (int i = 0; i < NUM_BATCHES; i++) {
+		ck_free(bqueue_pop(p.free_orders));
+		report_batch_t *reports = (report_batch_t *) 
+			bqueue_pop(p.free_reports);
+		for (int j = 0; j < BATCH_LINES; j++) {
+			free_action_report(reports->reports[j]);
+		}
+		ck_free(reports);
+	}
+	free_bqueue(p.parsed);
+	free_bqueue(p.free_orders);
+	free_bqueue(p.matched);
+	free_bqueue(p.free_reports);
 }
 
+/*
+ * is_number: is the string a non-empty run of digits?
+ */
+bool is_number(char *s) {
+	if (*s == '\0') {
+		return false;
+	}
+	for (; *s != '\0'; s++) {
+		if (*s < '0' || *s > '9') {
+			return false;
+		}
+	}
+	return true;
+}
+
+void usage() {
+	fprintf(stderr,"usage: simulate [-b] [-l] [-B book] <ticker symbol> "
+		"<test number> \n");
+	fprintf(stderr,"       simulate [-b] [-l] [-B book] <ticker symbol> "
+		"<orders file> <actions file>\n");
+	fprintf(stderr,"  Use -m as the ticker to take every ticker, and add "
+		"a thread count\n  to match on that many worker threads. Use - "
+		"for stdin or stdout.\n  -b writes a binary action log; "
+		"actlog turns it back into text.\n  -l prints latency "
+		"percentiles for each path through the\n  exchange to stderr, "
+		"timing one order in %d; every column, max\n  included, is over "
+		"the orders timed. The orders file may be a\n  binary order "
+		"log made by ordlog.\n  -B picks the book representation: "
+		"ladder, heap or list.\n",
+		LATENCY_SAMPLE_EVERY);
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	bool binary = false;
+	latency_stats_t *latency = NULL;
+	while (argc > 1 && (strcmp(argv[1], "-b") == 0 ||
+			    strcmp(argv[1], "-l") == 0 ||
+			    strcmp(argv[1], "-B") == 0)) {
+		if (argv[1][1] == 'b') {
+			binary = true;
+		} else if (argv[1][1] == 'B') {
+			const book_ops_t *ops = argc > 2 ? 
+				find_book_ops(argv[2]) : NULL;
+			if (ops == NULL) {
+				usage();
+			}
+			set_default_book_ops(ops);
+			argc--;
+			argv++;
+		} else if (latency == NULL) {
+			latency = mk_latency_stats(LATENCY_SAMPLE_EVERY);
+		}
+		argc--;
+		argv++;
+	}
+	if (argc < 3) {
+		usage();
+	}
+	bool every_ticker = strcmp(argv[1], "-m") == 0;
+	char in_path[MAX_TEST_FILENAME];
+	char out_path[MAX_TEST_FILENAME];
+	char *in_name, *out_name;
+	int next_arg;
+	if (is_number(argv[2])) {
+		int order_num = atoi(argv[2]);
+		snprintf(in_path, MAX_TEST_FILENAME, "tests/test%d_orders.csv",
+			order_num);
+		snprintf(out_path, MAX_TEST_FILENAME, "tests/test%d_actions.%s",
+			order_num, binary ? "bin" : "csv");
+		in_name = in_path;
+		out_name = out_path;
+		next_arg = 3;
+	} else if (argc >= 4) {
+		in_name = argv[2];
+		out_name = argv[3];
+		next_arg = 4;
+	} else {
+		usage();
+	}
+	int threads = 0;
+	if (argc == next_arg + 1 && every_ticker) {
+		threads = atoi(argv[next_arg]);
+	} else if (argc != next_arg) {
+		usage();
+	}
+
+	int in = STDIN_FILENO;
+	if (strcmp(in_name, "-") != 0) {
+		in = open(in_name, O_RDONLY);
+		if (in < 0) {
+			fprintf(stderr,"simulate: cannot open %s\n", in_name);
+			exit(1);
+		}
+	}
+	FILE *out = stdout;
+	if (strcmp(out_name, "-") != 0) {
+		out = fopen(out_name, "w");
+		if (out == NULL) {
+			fprintf(stderr, "simulate: cannot write %s\n", out_name);
+			exit(1);
+		}
+	}
+
+	if (threads > 0) {
+		shard_set_t *shards = mk_shard_set(threads, true);
+		if (latency != NULL) {
+			shard_track_latency(shards,
+				latency_sample_every(latency));
+		}
+		query(in, out, binary, NULL, NULL, shards);
+		if (latency != NULL) {
+			shard_latency(shards, latency);
+		}
+		free_shard_set(shards);
+	} else if (every_ticker) {
+		market_t *market = mk_market();
+		market_track_latency(market, latency);
+		query(in, out, binary, NULL, market, NULL);
+		fprintf(stderr, "simulate: %d tickers\n", 
+			market_num_exchanges(market));
+		free_market(market);
+	} else {
+		exchange_t *exchange = mk_exchange(argv[1]);
+		exchange_track_latency(exchange, latency);
+		query(in, out, binary, exchange, NULL, NULL);
+		free_exchange(exchange);
+	}
+	if (out != stdout) {
+		fclose(out);
+	}
+	if (in != STDIN_FILENO) {
+		close(in);
+	}
+	if (latency != NULL) {
+		print_latency_stats(latency, stderr);
+		free_latency_stats(latency);
+	}
+	trace_dump(stderr);     // empty unless built with make TRACE=1 or 2
+}
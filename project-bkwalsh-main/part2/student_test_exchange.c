@@ -5,14 +5,28 @@
  * You may modify this file.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <assert.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <limits.h>
 
 #include "order.h"
+#include "book.h"
 #include "action_report.h"
 #include "exchange.h"
+#include "market.h"
+#include "shard.h"
+#include "action_sink.h"
+#include "action_log.h"
+#include "order_log.h"
+#include "batch_parse.h"
+#include "trace.h"
+#include "latency.h"
+#include "action_writer.h"
 #include "util.h"
 
 /*
@@ -466,6 +480,787 @@ void do_handout() {
 
 
 
+/* assert_same_output: check that two files written by a test hold the
+ *  same bytes. Both are read from the start.
+ */
+void assert_same_output(FILE *a, FILE *b) {
+    fflush(a);
+    fflush(b);
+    rewind(a);
+    rewind(b);
+    int c;
+    do {
+        c = fgetc(a);
+        assert(c == fgetc(b));
+    } while (c != EOF);
+}
+
+
+/* make_order_stream: order lines for the tests that send the same
+ *  orders down two paths and compare what comes out. The tickers take
+ *  turns. Shares and prices vary so that adds both rest and trade, and
+ *  every fifth order cancels an earlier add of the same ticker, which
+ *  may have traded away since.
+ *
+ * num_orders: the number of lines
+ * tickers: the tickers to use
+ * num_tickers: how many there are
+ *
+ * Returns: the lines, to be freed with free_order_stream
+ */
+char **make_order_stream(int num_orders, char **tickers, int num_tickers) {
+    char **lines = (char **) ck_malloc(sizeof(char *) * num_orders,
+                                       "make_order_stream");
+    char ord_str[100];
+    for (int i = 0; i < num_orders; i++) {
+        int turn = i / num_tickers;     // this ticker's order number
+        char type = (i % 5 == 4 && turn >= 3) ? 'C' : 'A';
+        int oref = (type == 'C') ? i - num_tickers * (1 + turn % 3) : i;
+        sprintf(ord_str, "I,%s,%c,%c,%d,%d,%d", tickers[i % num_tickers],
+                type, (turn % 2 == 0) ? 'B' : 'S', 10 + (i * 37) % 90,
+                550000 + ((i * 7919) % 21 - 10) * 100, oref);
+        lines[i] = ck_strdup(ord_str, "make_order_stream");
+    }
+    return lines;
+}
+
+/* free_order_stream: free the lines from make_order_stream */
+void free_order_stream(char **lines, int num_orders) {
+    for (int i = 0; i < num_orders; i++) {
+        ck_free(lines[i]);
+    }
+    ck_free(lines);
+}
+
+
+/* write_action: action_fn that writes each action the way
+ *  write_action_report_to_file does
+ */
+void write_action(void *ctx, int time, enum action action, long long oref,
+                  long long price, int shares) {
+    char *names[] = {"BOOKED_BUY", "BOOKED_SELL", "EXECUTE", "CANCEL_BUY",
+                     "CANCEL_SELL"};
+    fprintf((FILE *) ctx, "%d,%s,%lld,%lld,%d\n", time, names[action], oref,
+            price, shares);
+}
+
+/* submit: send an order into a reused report, or to the exchange's
+ *  sink if ar is NULL
+ */
+void submit(exchange_t *exchange, action_report_t *ar, char *ord_str,
+            int time) {
+    if (ar != NULL) {
+        process_order_into(exchange, ord_str, time, ar);
+    } else {
+        send_order(exchange, ord_str, time);
+    }
+}
+
+/* sweep_round: book sells at ten prices, then send a buy that sweeps
+ *  all of them, so the book is empty again afterwards
+ *
+ * exchange: the exchange
+ * ar: the report to reuse, or NULL to send the orders to the exchange's
+ *   sink
+ * round: which round this is; keeps the orefs apart
+ * time: the time of the next order, advanced past the round
+ *
+ * Returns: how many allocations the sweeping buy made
+ */
+unsigned long sweep_round(exchange_t *exchange, action_report_t *ar,
+                          int round, int *time) {
+    char ord_str[100];
+    for (int i = 0; i < 10; i++) {
+        sprintf(ord_str, "I,UOCCS,A,S,100,%d,%d", 550000 + i * 100,
+                round * 100 + i);
+        submit(exchange, ar, ord_str, (*time)++);
+    }
+    sprintf(ord_str, "I,UOCCS,A,B,1000,560000,%d", round * 100 + 50);
+    unsigned long before = ck_alloc_count();
+    submit(exchange, ar, ord_str, (*time)++);
+    return ck_alloc_count() - before;
+}
+
+/* do_pool_stats: check that once the first round has filled the order
+ *  pool, later rounds only hit it
+ */
+void do_pool_stats() {
+    exchange_t *exchange = mk_exchange("UOCCS");
+    action_report_t *ar = mk_action_report("UOCCS");
+    int time = 0;
+    long hits, misses;
+    exchange_pool_stats(exchange, &hits, &misses);
+    assert(hits == 0 && misses == 0);
+    long warm_misses = 0;
+    long last_hits = 0;
+
+    for (int round = 0; round < 5; round++) {
+        sweep_round(exchange, ar, round, &time);
+        exchange_pool_stats(exchange, &hits, &misses);
+        printf("round %d: pool hits %ld, misses %ld\n", round, hits, misses);
+        if (round == 0) {
+            assert(misses > 0);
+            warm_misses = misses;
+        } else {
+            assert(misses == warm_misses);
+            assert(hits > last_hits);
+        }
+        last_hits = hits;
+    }
+    free_action_report(ar);
+    free_exchange(exchange);
+}
+
+
+/* do_fill_allocs: check that once warmed up, a sweep of ten fills
+ *  allocates nothing, into a reused report or through a sink
+ */
+void do_fill_allocs() {
+    exchange_t *exchange = mk_exchange("UOCCS");
+    action_report_t *ar = mk_action_report("UOCCS");
+    FILE *sink_fp = tmpfile();
+    assert(sink_fp != NULL);
+    action_sink_t sink = {write_action, sink_fp};
+    exchange_t *with_sink = mk_exchange_sink("UOCCS", &sink);
+    int time = 0;
+    int sink_time = 0;
+
+    for (int round = 0; round < 3; round++) {
+        unsigned long report_allocs = sweep_round(exchange, ar, round, &time);
+        unsigned long sink_allocs = sweep_round(with_sink, NULL, round,
+                                                &sink_time);
+        printf("round %d: 10-fill sweep allocs %lu with a reused report, "
+               "%lu with a sink\n", round, report_allocs, sink_allocs);
+        if (round > 0) {
+            assert(report_allocs == 0);
+            assert(sink_allocs == 0);
+        }
+    }
+    free_action_report(ar);
+    free_exchange(exchange);
+    free_exchange(with_sink);
+    fclose(sink_fp);
+}
+
+
+/* do_report_reuse: check that reset_action_report empties a report and
+ *  takes the new ticker, and that a report keeps the room it has grown
+ *  for actions and for its ticker across resets
+ */
+void do_report_reuse() {
+    action_report_t *ar = mk_action_report("UOCCS");
+    for (int i = 0; i < 50; i++) {
+        add_action(ar, BOOKED_BUY, i, 550000, 100);
+    }
+    assert(num_actions_in_report(ar) == 50);
+
+    reset_action_report(ar, "AMGN");
+    assert(num_actions_in_report(ar) == 0);
+    assert(strcmp(action_report_ticker(ar), "AMGN") == 0);
+    FILE *fp = tmpfile();
+    assert(fp != NULL);
+    write_action_report_to_file(ar, fp, 0);
+    assert(ftell(fp) == 0);
+    fclose(fp);
+
+    // grown past its first few slots, the report has room for 50 again
+    unsigned long before = ck_alloc_count();
+    for (int i = 0; i < 50; i++) {
+        add_action(ar, EXECUTE, i, 550000, 100);
+    }
+    assert(ck_alloc_count() == before);
+    enum action action;
+    long long oref, price;
+    int shares;
+    get_action(ar, 49, &action, &oref, &price, &shares);
+    assert(action == EXECUTE && oref == 49);
+
+    // a longer ticker grows the copy once; shorter ones reuse it
+    reset_action_report(ar, "AVERYLONGTICKER");
+    assert(strcmp(action_report_ticker(ar), "AVERYLONGTICKER") == 0);
+    before = ck_alloc_count();
+    reset_action_report(ar, "UOCCS");
+    reset_action_report(ar, "AVERYLONGTICKER");
+    assert(ck_alloc_count() == before);
+    assert(num_actions_in_report(ar) == 0);
+    printf("reset reports keep their room\n");
+    free_action_report(ar);
+}
+
+
+/* do_parse_errors: check that parse_order_line gives the right status
+ *  for good lines and for each way a line can be wrong, and the right
+ *  fields for the good ones
+ */
+void do_parse_errors() {
+    struct {
+        char *line;
+        enum parse_status status;
+        int shares;
+        long long oref;
+    } cases[] = {
+        {"I,UOCCS,A,S,100,550000,1000", PARSE_OK, 100, 1000},
+        {"I,UOCCS,A,S,100,550000,1000\r\n", PARSE_OK, 100, 1000},
+        {"I,UOCCS,A,S,100,550000,1000\n", PARSE_OK, 100, 1000},
+        {"I,UOCCS,C,B,2147483647,1,9223372036854775807", PARSE_OK,
+         INT_MAX, LLONG_MAX},
+        {"", PARSE_EMPTY, 0, 0},
+        {"\r\n", PARSE_EMPTY, 0, 0},
+        {"I", PARSE_BAD_VENUE, 0, 0},
+        {"IX,UOCCS,A,S,100,550000,1000", PARSE_BAD_VENUE, 0, 0},
+        {"I,,A,S,100,550000,1000", PARSE_BAD_TICKER, 0, 0},
+        {"I,UOCCS", PARSE_BAD_TICKER, 0, 0},
+        {"I,UOCCS,X,S,100,550000,1000", PARSE_BAD_TYPE, 0, 0},
+        {"I,UOCCS,AA,S,100,550000,1000", PARSE_BAD_TYPE, 0, 0},
+        {"I,UOCCS,A,X,100,550000,1000", PARSE_BAD_BOOK, 0, 0},
+        {"I,UOCCS,A,S", PARSE_BAD_BOOK, 0, 0},
+        {"I,UOCCS,A,S,0,550000,1000", PARSE_BAD_SHARES, 0, 0},
+        {"I,UOCCS,A,S,2147483648,550000,1000", PARSE_BAD_SHARES, 0, 0},
+        {"I,UOCCS,A,S,-5,550000,1000", PARSE_BAD_SHARES, 0, 0},
+        {"I,UOCCS,A,S,,550000,1000", PARSE_BAD_SHARES, 0, 0},
+        {"I,UOCCS,A,S,100", PARSE_BAD_SHARES, 0, 0},
+        {"I,UOCCS,A,S,100,55.5,1000", PARSE_BAD_PRICE, 0, 0},
+        {"I,UOCCS,A,S,100,550000", PARSE_BAD_PRICE, 0, 0},
+        {"I,UOCCS,A,S,100,9223372036854775808,1", PARSE_BAD_PRICE, 0, 0},
+        {"I,UOCCS,A,S,100,550000,", PARSE_BAD_OREF, 0, 0},
+        {"I,UOCCS,A,S,100,550000,99999999999999999999", PARSE_BAD_OREF,
+         0, 0},
+        {"I,UOCCS,A,S,100,550000,x", PARSE_BAD_OREF, 0, 0},
+        {"I,UOCCS,A,S,100,550000,1000x", PARSE_TRAILING, 0, 0},
+        {"I,UOCCS,A,S,100,550000,1000,", PARSE_TRAILING, 0, 0},
+        {"I,UOCCS,A,S,100,550000,1000 ", PARSE_TRAILING, 0, 0},
+        {"I,UOCCS,A,S,100,550000,1000\r\r\n", PARSE_TRAILING, 0, 0},
+    };
+    int num_cases = sizeof(cases) / sizeof(cases[0]);
+    for (int i = 0; i < num_cases; i++) {
+        order_msg_t msg;
+        enum parse_status status = parse_order_line(cases[i].line, &msg);
+        if (status != cases[i].status) {
+            printf("%s: got %s, expected %s\n", cases[i].line,
+                   parse_status_str(status),
+                   parse_status_str(cases[i].status));
+        }
+        assert(status == cases[i].status);
+        if (status == PARSE_OK) {
+            assert(msg.venue == 'I');
+            assert(msg.shares == cases[i].shares);
+            assert(msg.oref == cases[i].oref);
+        }
+    }
+    printf("parse_order_line checks out on %d lines\n", num_cases);
+}
+
+
+/* check_batch: parse a buffer with parse_order_batch, a few lines per
+ *  call, and check every line against parse_order. Without final, a
+ *  last line with no newline must be left unparsed.
+ */
+void check_batch(char *buf, size_t len, bool final) {
+    order_msg_t msgs[7];
+    enum parse_status statuses[7];
+    char *line = buf;
+    size_t pos = 0;
+    while (pos < len) {
+        int n;
+        size_t used = parse_order_batch(buf + pos, len - pos, final, msgs,
+                                        statuses, 7, &n);
+        if (n == 0) {
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            char *nl = memchr(line, '\n', buf + len - line);
+            char *end = nl != NULL ? nl : buf + len;
+            order_msg_t msg;
+            enum parse_status status = parse_order(line, end, &msg);
+            assert(statuses[i] == status);
+            if (status == PARSE_OK) {
+                assert(msgs[i].venue == msg.venue);
+                assert(msgs[i].symbol == msg.symbol);
+                assert(msgs[i].type == msg.type && msgs[i].book == msg.book);
+                assert(msgs[i].shares == msg.shares);
+                assert(msgs[i].price == msg.price);
+                assert(msgs[i].oref == msg.oref);
+            }
+            line = nl != NULL ? nl + 1 : buf + len;
+        }
+        pos += used;
+        assert(buf + pos == line);
+    }
+    if (final) {
+        assert(pos == len);
+    } else {
+        assert(memchr(buf + pos, '\n', len - pos) == NULL);
+    }
+}
+
+/* do_batch_parse: check that parse_order_batch agrees with parse_order
+ *  with every separator scan, on good and bad lines, CRLF endings, lines
+ *  longer than the scan window and a last line with no newline
+ */
+void do_batch_parse() {
+    char *lines[] = {"I,UOCCS,A,S,100,550000,1000",
+                     "N,AMGN,C,B,2147483647,1999999900,9999999999999",
+                     "I,UOCCS,A,B,70,558000,1070\r",
+                     "",
+                     "\r",
+                     "I,UOCCS,A,S,0,550000,4001",
+                     "I,UOCCS,A,S,2147483648,550000,4002",
+                     "I,UOCCS,A,S,100,550000,99999999999999999999",
+                     "I,UOCCS,A,S,100,123456789012345678,4003",
+                     "I,UOCCS,A,S,100,1234567890123456789,4004",
+                     "I,UOCCS,A,S,1-0,550000,4005",
+                     "I,UOCCS,A,S,100,550000,4006,",
+                     "I,UOCCS,X,S,100,550000,4007",
+                     "I,A,A,B,1,1,1",
+                     "I,ABCDEFGH,A,B,1,1,1",
+                     "I,ABCDEFGHIJKL,A,B,12,3456,7890",
+                     "I,UOCCS,A,S,100,550000,1000,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,"};
+    int num_lines = sizeof(lines) / sizeof(lines[0]);
+    size_t long_len = 20000;
+    size_t size = 1 << 20;
+    char *buf = (char *) ck_malloc(size, "do_batch_parse");
+    size_t len = 0;
+
+    for (int i = 0; len + 2 * long_len < size; i++) {
+        if (i % 500 == 250) {
+            // a line longer than the scan window: a long ticker (with
+            // zero shares, so it is not interned) or a run of commas
+            len += sprintf(buf + len, "I,");
+            memset(buf + len, (i % 1000 == 250) ? 'T' : ',', long_len);
+            len += long_len;
+            len += sprintf(buf + len, ",A,B,0,1,%d\n", i);
+        } else {
+            len += sprintf(buf + len, "%s\n", lines[i % num_lines]);
+        }
+    }
+    len += sprintf(buf + len, "I,UOCCS,A,S,100,550000,77");
+
+    for (int isa = BATCH_SCALAR; isa <= best_batch_isa(); isa++) {
+        set_batch_isa(isa);
+        check_batch(buf, len, true);
+        check_batch(buf, len, false);
+        // every line ends in a newline
+        check_batch(buf, len - strlen("I,UOCCS,A,S,100,550000,77"), false);
+        printf("parse_order_batch matches parse_order with %s\n",
+               batch_isa_str(isa));
+    }
+    set_batch_isa(best_batch_isa());
+    ck_free(buf);
+}
+
+
+/* do_fields_match: check that orders sent as fields get the same
+ *  actions as the same orders sent as lines
+ */
+void do_fields_match() {
+    char *tickers[] = {"UOCCS"};
+    int num_orders = 200;
+    char **lines = make_order_stream(num_orders, tickers, 1);
+    exchange_t *by_line = mk_exchange("UOCCS");
+    exchange_t *by_fields = mk_exchange("UOCCS");
+    FILE *line_fp = tmpfile();
+    FILE *fields_fp = tmpfile();
+    assert(line_fp != NULL && fields_fp != NULL);
+
+    for (int i = 0; i < num_orders; i++) {
+        action_report_t *ar = process_order(by_line, lines[i], i);
+        write_action_report_to_file(ar, line_fp, i);
+        free_action_report(ar);
+        order_msg_t msg;
+        assert(parse_order_line(lines[i], &msg) == PARSE_OK);
+        ar = process_order_fields(by_fields, msg.venue, msg.type, msg.book,
+                                  msg.shares, msg.price, msg.oref, i);
+        write_action_report_to_file(ar, fields_fp, i);
+        free_action_report(ar);
+    }
+
+    assert_same_output(line_fp, fields_fp);
+    printf("process_order_fields matches process_order\n");
+    fclose(line_fp);
+    fclose(fields_fp);
+    free_exchange(by_line);
+    free_exchange(by_fields);
+    free_order_stream(lines, num_orders);
+}
+
+
+/* do_book_backends: check that every book representation gives the
+ *  same actions. Some orders arrive late, so time priority within a
+ *  price has to come from the order's time and not from when it was
+ *  inserted.
+ */
+void do_book_backends() {
+    char *tickers[] = {"UOCCS"};
+    int num_orders = 300;
+    char **lines = make_order_stream(num_orders, tickers, 1);
+    const char *names[] = {"ladder", "heap", "list"};
+    int num_books = sizeof(names) / sizeof(names[0]);
+    FILE *fps[num_books];
+    assert(find_book_ops("skiplist") == NULL);
+    for (int b = 0; b < num_books; b++) {
+        const book_ops_t *ops = find_book_ops(names[b]);
+        assert(ops != NULL && strcmp(book_ops_name(ops), names[b]) == 0);
+        exchange_t *exchange = mk_exchange_book("UOCCS", ops);
+        fps[b] = tmpfile();
+        assert(fps[b] != NULL);
+        for (int i = 0; i < num_orders; i++) {
+            int time = (i % 11 == 10) ? i - 5 : i;
+            action_report_t *ar = process_order(exchange, lines[i], time);
+            write_action_report_to_file(ar, fps[b], time);
+            free_action_report(ar);
+        }
+        free_exchange(exchange);
+    }
+
+    for (int b = 1; b < num_books; b++) {
+        assert_same_output(fps[0], fps[b]);
+    }
+    for (int b = 0; b < num_books; b++) {
+        fclose(fps[b]);
+    }
+    free_order_stream(lines, num_orders);
+    printf("every book representation gives the same actions\n");
+}
+
+/* do_sink: check that an exchange with a sink gives the same actions as
+ *  one that fills reports
+ */
+void do_sink() {
+    char *tickers[] = {"UOCCS"};
+    int num_orders = 200;
+    char **lines = make_order_stream(num_orders, tickers, 1);
+    FILE *sink_fp = tmpfile();
+    FILE *report_fp = tmpfile();
+    assert(sink_fp != NULL && report_fp != NULL);
+    action_sink_t sink = {write_action, sink_fp};
+    exchange_t *with_sink = mk_exchange_sink("UOCCS", &sink);
+    exchange_t *with_reports = mk_exchange("UOCCS");
+
+    for (int i = 0; i < num_orders; i++) {
+        send_order(with_sink, lines[i], i);
+        action_report_t *ar = process_order(with_reports, lines[i], i);
+        write_action_report_to_file(ar, report_fp, i);
+        free_action_report(ar);
+    }
+
+    assert_same_output(sink_fp, report_fp);
+    printf("sink matches action reports\n");
+    fclose(sink_fp);
+    fclose(report_fp);
+    free_exchange(with_sink);
+    free_exchange(with_reports);
+    free_order_stream(lines, num_orders);
+}
+
+
+/* do_writer: check that an action writer writes the same bytes as
+ *  write_action_report_to_file, including numbers at the edges of their
+ *  types
+ */
+void do_writer() {
+    long long values[] = {0, 1, 9, 10, 99, 100, 12345, 999999, 1000000,
+                          INT_MAX, 9999999999999LL, LLONG_MAX, -1, 
+                          LLONG_MIN};
+    int num_values = sizeof(values) / sizeof(values[0]);
+    FILE *writer_fp = tmpfile();
+    FILE *report_fp = tmpfile();
+    assert(writer_fp != NULL && report_fp != NULL);
+    action_writer_t *writer = mk_action_writer(fileno(writer_fp));
+    action_report_t *ar = mk_action_report("UOCCS");
+
+    for (int i = 0; i < num_values; i++) {
+        for (int j = 0; j < num_values; j++) {
+            int shares = 1 + (i * 37 + j) % 1000;
+            if (j == 0) {
+                shares = INT_MAX;
+            }
+            enum action action = (i + j) % (CANCEL_SELL + 1);
+            reset_action_report(ar, "UOCCS");
+            add_action(ar, action, values[i], values[j], shares);
+            write_action_report_to_file(ar, report_fp, i * num_values + j);
+            writer_add_report(writer, ar, i * num_values + j);
+        }
+    }
+    free_action_writer(writer);
+    fflush(report_fp);
+
+    assert_same_output(writer_fp, report_fp);
+    printf("action writer matches write_action_report_to_file\n");
+    free_action_report(ar);
+    fclose(writer_fp);
+    fclose(report_fp);
+}
+
+/* do_action_log: check that a binary action log gives back every field
+ *  of every action, including numbers at the edges of their types
+ */
+void do_action_log() {
+    long long values[] = {0, 1, 255, 256, INT_MAX, 9999999999999LL,
+                          LLONG_MAX, -1, LLONG_MIN};
+    int shares[] = {1, 100, 65536, INT_MAX};
+    int num_values = sizeof(values) / sizeof(values[0]);
+    int num_shares = sizeof(shares) / sizeof(shares[0]);
+    FILE *fp = tmpfile();
+    assert(fp != NULL);
+    action_writer_t *writer = mk_action_log_writer(fileno(fp));
+    int num_records = 0;
+    for (int i = 0; i < num_values; i++) {
+        for (int j = 0; j < num_values; j++) {
+            writer_add_action(writer, num_records,
+                              num_records % (CANCEL_SELL + 1), values[i],
+                              values[j], shares[num_records % num_shares]);
+            num_records++;
+        }
+    }
+    free_action_writer(writer);
+
+    rewind(fp);
+    unsigned char buf[ACTION_LOG_RECORD_LEN];
+    assert(fread(buf, ACTION_LOG_MAGIC_LEN, 1, fp) == 1);
+    assert(memcmp(buf, ACTION_LOG_MAGIC, ACTION_LOG_MAGIC_LEN) == 0);
+    for (int n = 0; n < num_records; n++) {
+        action_record_t rec;
+        assert(fread(buf, ACTION_LOG_RECORD_LEN, 1, fp) == 1);
+        assert(decode_action_record(buf, &rec));
+        assert(rec.index == n);
+        assert(rec.action == n % (CANCEL_SELL + 1));
+        assert(rec.oref == values[n / num_values]);
+        assert(rec.price == values[n % num_values]);
+        assert(rec.shares == shares[n % num_shares]);
+    }
+    assert(fgetc(fp) == EOF);
+    printf("action log gives back %d actions\n", num_records);
+    fclose(fp);
+}
+
+/* do_order_log: write a few parsed lines, one of them bad and one with
+ *  a long ticker, to an order log and check that reading it back gives
+ *  the same orders and times
+ */
+void do_order_log() {
+    char *lines[] = {"I,UOCCS,A,S,100,550000,4000",
+                     "I,AMGN,C,B,70,1999999900,9999999999999",
+                     "I,UOCCS,A,S,0,550000,4001",
+                     "N,UOCCS,A,B,2147483647,1,1",
+                     "I,AVERYLONGTICKERSYMBOLNAME,A,B,5,100,7"};
+    int times[] = {10, 20, 20, 15, -3};
+    int num_lines = sizeof(lines) / sizeof(lines[0]);
+    order_msg_t msgs[num_lines];
+    enum parse_status statuses[num_lines];
+    order_log_writer_t *w = mk_order_log_writer();
+    for (int i = 0; i < num_lines; i++) {
+        statuses[i] = parse_order_line(lines[i], &msgs[i]);
+        order_log_measure(w, &msgs[i], statuses[i], times[i]);
+    }
+    assert(statuses[2] == PARSE_BAD_SHARES);
+    FILE *fp = tmpfile();
+    assert(fp != NULL);
+    start_order_log(w, fileno(fp));
+    for (int i = 0; i < num_lines; i++) {
+        order_log_add(w, &msgs[i], statuses[i], times[i]);
+    }
+    finish_order_log(w);
+    free_order_log_writer(w);
+
+    fseek(fp, 0, SEEK_END);
+    long len = ftell(fp);
+    rewind(fp);
+    char *buf = (char *) ck_malloc(len, "do_order_log");
+    assert(fread(buf, len, 1, fp) == 1);
+    order_log_t *log = open_order_log(buf, len);
+    assert(log != NULL);
+    assert(order_log_length(log) == num_lines);
+    for (int i = 0; i < num_lines; i++) {
+        order_msg_t msg;
+        int time;
+        assert(order_log_msg(log, i, &msg, &time) == statuses[i]);
+        assert(time == times[i]);
+        if (statuses[i] == PARSE_OK) {
+            assert(msg.price == msgs[i].price && msg.oref == msgs[i].oref);
+            assert(msg.shares == msgs[i].shares);
+            assert(msg.symbol == msgs[i].symbol);
+            assert(msg.venue == msgs[i].venue && msg.type == msgs[i].type &&
+                   msg.book == msgs[i].book);
+        }
+    }
+    assert(open_order_log(buf, len - 1) == NULL);
+    printf("order log gives back %d lines\n", num_lines);
+    free_order_log(log);
+    ck_free(buf);
+    fclose(fp);
+}
+
+/* do_trace: check that making and freeing an order is traced exactly
+ *  when order tracing is compiled in
+ */
+void do_trace() {
+    long before = trace_count();
+    order_t *o = mk_order_from_line("I,UOCCS,A,S,100,550000,4242", 0);
+    free_order(o);
+    long events = trace_count() - before;
+    if (TRACE_LEVEL < TRACE_ORDERS) {
+        assert(events == 0);
+        printf("order tracing is compiled out\n");
+        return;
+    }
+    assert(events == 2);
+    FILE *fp = tmpfile();
+    assert(fp != NULL);
+    trace_dump(fp);
+    rewind(fp);
+    char line[100];
+    char last[2][100] = {"", ""};
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        strcpy(last[0], last[1]);
+        strcpy(last[1], line);
+    }
+    assert(strstr(last[0], ",ORDER_MADE,4242\n") != NULL);
+    assert(strstr(last[1], ",ORDER_FREED,4242\n") != NULL);
+    printf("order tracing records %ld events\n", trace_count());
+    fclose(fp);
+}
+
+/* do_latency: check that orders are timed under the path they take and
+ *  that percentiles come out of the histogram where they should
+ */
+void do_latency() {
+    char *orders[] = {"I,UOCCS,A,S,100,550000,1",      // book
+                      "I,UOCCS,A,B,100,550000,2",      // match 1 level
+                      "I,UOCCS,A,S,100,550000,3",      // book
+                      "I,UOCCS,A,S,100,551000,4",      // book
+                      "I,UOCCS,A,B,300,560000,5",      // match 2, books rest
+                      "I,UOCCS,C,B,100,560000,5",      // cancel hit
+                      "I,UOCCS,C,B,100,560000,5"};     // cancel miss
+    enum latency_path paths[] = {LATENCY_BOOK, LATENCY_MATCH_1, LATENCY_BOOK,
+                                 LATENCY_BOOK, LATENCY_MATCH_2,
+                                 LATENCY_CANCEL_HIT, LATENCY_CANCEL_MISS};
+    int num_orders = sizeof(orders) / sizeof(orders[0]);
+    latency_stats_t *stats = mk_latency_stats(1);
+    exchange_t *exchange = mk_exchange("UOCCS");
+    exchange_track_latency(exchange, stats);
+    action_report_t *ar = mk_action_report("UOCCS");
+    for (int i = 0; i < num_orders; i++) {
+        process_order_into(exchange, orders[i], i, ar);
+        int expected = 0;
+        for (int j = 0; j <= i; j++) {
+            expected += paths[j] == paths[i];
+        }
+        assert(latency_count(stats, paths[i]) == expected);
+    }
+    free_action_report(ar);
+    free_exchange(exchange);
+    free_latency_stats(stats);
+
+    // 1..1000 ticks: the median is half the maximum, to within a bucket
+    stats = mk_latency_stats(1);
+    for (int ticks = 1; ticks <= 1000; ticks++) {
+        latency_record(stats, LATENCY_BOOK, ticks);
+    }
+    double max = latency_max_ns(stats, LATENCY_BOOK);
+    double p50 = latency_percentile_ns(stats, LATENCY_BOOK, 50);
+    double p99 = latency_percentile_ns(stats, LATENCY_BOOK, 99);
+    assert(max > 0);
+    assert(p50 / max >= 0.5 && p50 / max <= 0.5 * 1.0625);
+    assert(p99 / max >= 0.99 && p99 <= max);
+    assert(latency_percentile_ns(stats, LATENCY_MATCH_1, 50) == 0);
+    printf("latency paths and percentiles check out\n");
+    free_latency_stats(stats);
+}
+
+
+/* do_market: check that a market gives each ticker the actions its own
+ *  exchange would, and that an exchange turns away orders for another
+ *  ticker
+ */
+void do_market() {
+    char *tickers[] = {"UOCCS", "AMGN"};
+    int num_orders = 200;
+    char **lines = make_order_stream(num_orders, tickers, 2);
+    market_t *market = mk_market();
+    exchange_t *singles[] = {mk_exchange("UOCCS"), mk_exchange("AMGN")};
+    FILE *market_fp = tmpfile();
+    FILE *single_fp = tmpfile();
+    assert(market_fp != NULL && single_fp != NULL);
+
+    for (int i = 0; i < num_orders; i++) {
+        action_report_t *ar = market_process_order(market, lines[i], i);
+        write_action_report_to_file(ar, market_fp, i);
+        free_action_report(ar);
+        ar = process_order(singles[i % 2], lines[i], i);
+        write_action_report_to_file(ar, single_fp, i);
+        free_action_report(ar);
+    }
+    assert(market_num_exchanges(market) == 2);
+    assert(market_exchange(market, "UOCCS") != NULL);
+    assert(market_exchange(market, "NOPE") == NULL);
+
+    assert_same_output(market_fp, single_fp);
+
+    // AMGN orders do not belong on the UOCCS exchange
+    FILE *wrong_fp = tmpfile();
+    action_report_t *ar = process_order(singles[0],
+                                        "I,AMGN,A,B,10,550000,999",
+                                        num_orders);
+    write_action_report_to_file(ar, wrong_fp, num_orders);
+    assert(ftell(wrong_fp) == 0);
+    free_action_report(ar);
+    printf("market matches one exchange per ticker\n");
+
+    fclose(market_fp);
+    fclose(single_fp);
+    fclose(wrong_fp);
+    free_exchange(singles[0]);
+    free_exchange(singles[1]);
+    free_market(market);
+    free_order_stream(lines, num_orders);
+}
+
+
+/* do_shards: send more orders than a worker's ring holds, for several
+ *  tickers, through shard sets with one and with several workers, and
+ *  check that the merged actions are the bytes a market writes
+ */
+void do_shards() {
+    char *tickers[] = {"UOCCS", "AMGN", "AAPL", "MSFT", "IBM"};
+    int num_tickers = sizeof(tickers) / sizeof(tickers[0]);
+    int num_orders = 12000;
+    char **orders = make_order_stream(num_orders, tickers, num_tickers);
+
+    FILE *market_fp = tmpfile();
+    assert(market_fp != NULL);
+    market_t *market = mk_market();
+    action_report_t *ar = mk_action_report("UOCCS");
+    for (int i = 0; i < num_orders; i++) {
+        order_msg_t msg;
+        assert(parse_order_line(orders[i], &msg) == PARSE_OK);
+        market_process_msg_into(market, &msg, i, ar);
+        write_action_report_to_file(ar, market_fp, i);
+    }
+    free_action_report(ar);
+    free_market(market);
+
+    int workers[] = {1, 3};
+    for (int w = 0; w < 2; w++) {
+        FILE *shard_fp = tmpfile();
+        assert(shard_fp != NULL);
+        shard_set_t *set = mk_shard_set(workers[w], false);
+        for (int i = 0; i < num_orders; i++) {
+            shard_submit_order(set, orders[i], i);
+        }
+        action_writer_t *writer = mk_action_writer(fileno(shard_fp));
+        shard_write_actions(set, writer);
+        free_action_writer(writer);
+        free_shard_set(set);
+        assert_same_output(market_fp, shard_fp);
+        printf("%d shard workers match the market\n", workers[w]);
+        fclose(shard_fp);
+    }
+
+    fclose(market_fp);
+    free_order_stream(orders, num_orders);
+}
+
+
 int main() {
     // uncomment to check exchange constructor and free before trying
     // any orders.
@@ -473,6 +1268,32 @@ int main() {
   //  do_one();
   do_a_few();
 
+  do_pool_stats();
+
+  do_fill_allocs();
+
+  do_report_reuse();
+
+  do_parse_errors();
+
+  do_batch_parse();
+
+  do_fields_match();
+
+  do_book_backends();
+
+  do_market();
+
+  do_shards();
+
+  do_sink();
+
+  do_writer();
+  do_action_log();
+  do_order_log();
+  do_trace();
+  do_latency();
+
     // uncomment to process all the samples order
   // do_all();
 
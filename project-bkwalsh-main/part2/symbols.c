@@ -0,0 +1,183 @@
+/*
+ * CS 152, Spring 2022
+ * Symbol Table Implementation
+ *
+ * Names are kept in fixed size blocks indexed by id. Blocks never move,
+ * so other threads can read the name for an id they were handed while
+ * new tickers are being interned. Lookups go through an open addressing
+ * hash table of ids that doubles when it is half full.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "symbols.h"
+#include "util.h"
+
+#define BLOCK_NAMES 1024
+#define MAX_BLOCKS 4096
+#define INIT_TABLE_SLOTS 64
+
+static char **blocks[MAX_BLOCKS];   // interned names, BLOCK_NAMES per block
+static atomic_int num_names = 0;
+static int *table = NULL;       // ids, NO_SYMBOL marks an empty slot
+static int table_slots = 0;     // always a power of two
+
+/*
+ * hash_ticker: FNV-1a hash of a ticker
+ */
+static unsigned int hash_ticker(const char *ticker, int len) {
+    unsigned int h = 2166136261u;
+    for (int i = 0; i < len; i++) {
+        h ^= (unsigned char) ticker[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/*
+ * name_of: the interned name for an id
+ */
+static char *name_of(int id) {
+    return blocks[id / BLOCK_NAMES][id % BLOCK_NAMES];
+}
+
+/*
+ * same_name: does the interned name for id match the ticker?
+ */
+static bool same_name(int id, const char *ticker, int len) {
+    char *name = name_of(id);
+    return strncmp(name, ticker, len) == 0 && name[len] == '\0';
+}
+
+/*
+ * probe: find the table slot holding the ticker, or the empty slot where
+ *   it would go
+ */
+static int probe(const char *ticker, int len) {
+    int mask = table_slots - 1;
+    int i = hash_ticker(ticker, len) & mask;
+    while (table[i] != NO_SYMBOL && !same_name(table[i], ticker, len)) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/*
+ * alloc_table: make an empty hash table with the given number of slots
+ */
+static void alloc_table(int slots) {
+    table = (int *) ck_malloc(sizeof(int) * slots, "alloc_table");
+    for (int i = 0; i < slots; i++) {
+        table[i] = NO_SYMBOL;
+    }
+    table_slots = slots;
+}
+
+/*
+ * grow_table: double the hash table and re-insert every id
+ */
+static void grow_table() {
+    int *old = table;
+    int old_slots = table_slots;
+    alloc_table(old_slots * 2);
+    for (int i = 0; i < old_slots; i++) {
+        if (old[i] != NO_SYMBOL) {
+            char *name = name_of(old[i]);
+            table[probe(name, strlen(name))] = old[i];
+        }
+    }
+    ck_free(old);
+}
+
+/*
+ * intern_symbol_n: like intern_symbol, but for a ticker that is not
+ *   NUL terminated, such as one still sitting inside an order line
+ *
+ * ticker: start of the ticker symbol
+ * len: number of characters in the ticker
+ *
+ * Returns: the ticker's id
+ */
+int intern_symbol_n(const char *ticker, int len) {
+    if (table == NULL) {
+        alloc_table(INIT_TABLE_SLOTS);
+    }
+    int slot = probe(ticker, len);
+    if (table[slot] != NO_SYMBOL) {
+        return table[slot];
+    }
+
+    int id = atomic_load_explicit(&num_names, memory_order_relaxed);
+    if (id == BLOCK_NAMES * MAX_BLOCKS) {
+        fprintf(stderr, "intern_symbol: too many symbols\n");
+        exit(1);
+    }
+    if (id % BLOCK_NAMES == 0) {
+        blocks[id / BLOCK_NAMES] = (char **) 
+            ck_malloc(sizeof(char *) * BLOCK_NAMES, "intern_symbol");
+    }
+    char *name = (char *) ck_malloc(len + 1, "intern_symbol");
+    memcpy(name, ticker, len);
+    name[len] = '\0';
+    blocks[id / BLOCK_NAMES][id % BLOCK_NAMES] = name;
+    table[slot] = id;
+    // publish the name before the new count
+    atomic_store_explicit(&num_names, id + 1, memory_order_release);
+    if ((id + 1) * 2 > table_slots) {
+        grow_table();
+    }
+    return id;
+}
+
+/*
+ * intern_symbol: get the id for a ticker, adding it to the table if it
+ *   has not been seen before
+ *
+ * ticker: the ticker symbol
+ *
+ * Returns: the ticker's id
+ */
+int intern_symbol(char *ticker) {
+    assert(ticker != NULL);
+    return intern_symbol_n(ticker, strlen(ticker));
+}
+
+/*
+ * find_symbol: look up a ticker without adding it
+ *
+ * ticker: the ticker symbol
+ *
+ * Returns: the ticker's id, or NO_SYMBOL if it has not been interned
+ */
+int find_symbol(char *ticker) {
+    if (table == NULL) {
+        return NO_SYMBOL;
+    }
+    return table[probe(ticker, strlen(ticker))];
+}
+
+/*
+ * symbol_name: get the interned string for an id. The string lives as
+ *   long as the program and must not be freed or modified.
+ *
+ * symbol: an id returned by intern_symbol
+ *
+ * Returns: the ticker symbol
+ */
+char *symbol_name(int symbol) {
+    assert(symbol >= 0 && symbol < num_symbols());
+    return name_of(symbol);
+}
+
+/*
+ * num_symbols: the number of tickers interned so far. Ids run from 0 to
+ *   num_symbols() - 1.
+ */
+int num_symbols() {
+    return atomic_load_explicit(&num_names, memory_order_acquire);
+}
@@ -0,0 +1,66 @@
+/*
+ * CS 152, Spring 2022
+ * Symbol Table Interface.
+ *
+ * Interns ticker symbols: each distinct ticker string is stored once and
+ * given a small integer id, numbered from 0 in the order tickers are first
+ * seen. Orders carry the id and share the interned string, so comparing
+ * tickers is an integer compare and making an order copies no strings.
+ *
+ * The table is shared by the whole program. Only one thread may intern
+ * or look up tickers. Other threads may call symbol_name and num_symbols
+ * for ids handed to them, even while new tickers are being interned.
+ */
+
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#define NO_SYMBOL -1
+
+/*
+ * intern_symbol: get the id for a ticker, adding it to the table if it
+ *   has not been seen before
+ *
+ * ticker: the ticker symbol
+ *
+ * Returns: the ticker's id
+ */
+int intern_symbol(char *ticker);
+
+/*
+ * intern_symbol_n: like intern_symbol, but for a ticker that is not
+ *   NUL terminated, such as one still sitting inside an order line
+ *
+ * ticker: start of the ticker symbol
+ * len: number of characters in the ticker
+ *
+ * Returns: the ticker's id
+ */
+int intern_symbol_n(const char *ticker, int len);
+
+/*
+ * find_symbol: look up a ticker without adding it
+ *
+ * ticker: the ticker symbol
+ *
+ * Returns: the ticker's id, or NO_SYMBOL if it has not been interned
+ */
+int find_symbol(char *ticker);
+
+/*
+ * symbol_name: get the interned string for an id. The string lives as
+ *   long as the program and must not be freed or modified.
+ *
+ * symbol: an id returned by intern_symbol
+ *
+ * Returns: the ticker symbol
+ */
+char *symbol_name(int symbol);
+
+/*
+ * num_symbols: the number of tickers interned so far. Ids run from 0 to
+ *   num_symbols() - 1.
+ */
+int num_symbols();
+
+#endif
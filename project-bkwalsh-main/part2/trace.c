@@ -0,0 +1,93 @@
+/*
+ * CS 152, Spring 2022
+ * Trace Implementation
+ *
+ * Recording an event takes one atomic add to claim a slot and a plain
+ * store of the record. The ring only exists when some level of tracing
+ * is compiled in.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdatomic.h>
+
+#include "trace.h"
+
+#define TRACE_SLOTS 65536       // must be a power of two
+
+static const char *event_names[] = {"EXCHANGE_MADE", "EXCHANGE_FREED",
+                                    "ORDER_MADE", "ORDER_FREED"};
+
+#if TRACE_LEVEL > TRACE_NONE
+
+typedef struct trace_record {
+    uint64_t seq;
+    long long arg;
+    uint32_t event;
+} trace_record_t;
+
+static trace_record_t ring[TRACE_SLOTS];
+static atomic_ulong next_seq = 0;
+
+/*
+ * trace_event: record an event in the ring
+ *
+ * event: what happened
+ * arg: the ticker id for exchange events, the oref for order events
+ */
+void trace_event(enum trace_event event, long long arg) {
+    unsigned long seq = atomic_fetch_add_explicit(&next_seq, 1,
+                                                  memory_order_relaxed);
+    trace_record_t *rec = &ring[seq & (TRACE_SLOTS - 1)];
+    rec->seq = seq;
+    rec->arg = arg;
+    rec->event = event;
+}
+
+/*
+ * trace_count: the number of events recorded so far
+ */
+long trace_count() {
+    return atomic_load_explicit(&next_seq, memory_order_relaxed);
+}
+
+/*
+ * trace_dump: write the events still in the ring, oldest first
+ *
+ * fp: a file pointer
+ */
+void trace_dump(FILE *fp) {
+    unsigned long end = atomic_load_explicit(&next_seq, memory_order_acquire);
+    unsigned long start = end > TRACE_SLOTS ? end - TRACE_SLOTS : 0;
+    for (unsigned long seq = start; seq < end; seq++) {
+        trace_record_t *rec = &ring[seq & (TRACE_SLOTS - 1)];
+        fprintf(fp, "%lu,%s,%lld\n", (unsigned long) rec->seq,
+                trace_event_str(rec->event), rec->arg);
+    }
+}
+
+#else
+
+void trace_event(enum trace_event event, long long arg) {
+}
+
+long trace_count() {
+    return 0;
+}
+
+void trace_dump(FILE *fp) {
+}
+
+#endif
+
+/*
+ * trace_event_str: the name of an event
+ *
+ * Returns: a constant string
+ */
+const char *trace_event_str(enum trace_event event) {
+    if (event > TRACE_ORDER_FREED) {
+        return "UNKNOWN";
+    }
+    return event_names[event];
+}
@@ -0,0 +1,79 @@
+/*
+ * CS 152, Spring 2022
+ * Trace Interface.
+ *
+ * Trace points record what the engine does without printing. How much
+ * is traced is fixed when the program is compiled, by TRACE_LEVEL (make
+ * TRACE=2, say):
+ *
+ *   TRACE_NONE       nothing; every trace point compiles to nothing
+ *   TRACE_EXCHANGES  exchanges being made and freed
+ *   TRACE_ORDERS     also every order made and freed (the old
+ *                    "making..." and "freeing..." lines)
+ *
+ * Events go into a fixed size in-memory ring as small binary records,
+ * overwriting the oldest once it is full, and trace_dump writes out what
+ * the ring holds when it is asked to. Any thread may record events.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+
+#define TRACE_NONE 0
+#define TRACE_EXCHANGES 1
+#define TRACE_ORDERS 2
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL TRACE_NONE
+#endif
+
+enum trace_event {TRACE_EXCHANGE_MADE, TRACE_EXCHANGE_FREED,
+                  TRACE_ORDER_MADE, TRACE_ORDER_FREED};
+
+#if TRACE_LEVEL >= TRACE_EXCHANGES
+#define TRACE_EXCHANGE(event, symbol) trace_event((event), (symbol))
+#else
+#define TRACE_EXCHANGE(event, symbol) ((void) 0)
+#endif
+
+#if TRACE_LEVEL >= TRACE_ORDERS
+#define TRACE_ORDER(event, oref) trace_event((event), (oref))
+#else
+#define TRACE_ORDER(event, oref) ((void) 0)
+#endif
+
+/*
+ * trace_event: record an event in the ring. Use the TRACE_ macros, which
+ *   leave the call out when its level is not compiled in.
+ *
+ * event: what happened
+ * arg: the ticker id for exchange events, the oref for order events
+ */
+void trace_event(enum trace_event event, long long arg);
+
+/*
+ * trace_count: the number of events recorded so far, including ones
+ *   that have since been overwritten
+ */
+long trace_count();
+
+/*
+ * trace_dump: write the events still in the ring, oldest first, one per
+ *   line as sequence number, event and argument. Events recorded while
+ *   the dump runs may be left out or appear half written, so dump once
+ *   the threads being traced have stopped.
+ *
+ * fp: a file pointer
+ */
+void trace_dump(FILE *fp);
+
+/*
+ * trace_event_str: the name of an event
+ *
+ * Returns: a constant string
+ */
+const char *trace_event_str(enum trace_event event);
+
+#endif
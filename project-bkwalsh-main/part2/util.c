@@ -12,6 +12,10 @@
 // Include to quiet the compiler warnings.
 extern char *strdup(const char *);
 
+// number of blocks handed out by ck_malloc, ck_strdup and ck_realloc on
+// this thread
+static _Thread_local unsigned long num_allocs = 0;
+
 /* ck_malloc: allocate s bytes of space and return a pointer to it.
  * An error message with be printed and the program will exit
  * if malloc fails.
@@ -27,6 +31,7 @@ void *ck_malloc(unsigned long s, char *fn_name) {
         fprintf(stderr, "%s: ran out of space\n", fn_name);
         exit(1);
     }
+    num_allocs++;
 
     return tmp;
 }
@@ -55,6 +60,7 @@ char *ck_strdup(char *str, char *fn_name) {
         fprintf(stderr, "%s: ran out of space\n", fn_name);
         exit(1);
     }
+    num_allocs++;
     return dup;
 }
 
@@ -75,7 +81,17 @@ void *ck_realloc(void *ptr, unsigned long num_bytes, char *fn_name) {
         fprintf(stderr, "%s: ran out of space\n", fn_name);
         exit(1);
     }
+    num_allocs++;
 
     return tmp;
 }
 
+/* ck_alloc_count: the number of blocks handed out by ck_malloc,
+ * ck_strdup and ck_realloc so far on the calling thread. Useful for
+ * checking that a code path does not allocate.
+ *
+ * Returns: number of allocations
+ */
+unsigned long ck_alloc_count() {
+    return num_allocs;
+}
@@ -48,4 +48,13 @@ char *ck_strdup(char *str, char *fn_name);
 void *ck_realloc(void *ptr, unsigned long num_bytes, char *fn_name);
 
 
+/* ck_alloc_count: the number of blocks handed out by ck_malloc,
+ * ck_strdup and ck_realloc so far on the calling thread. Useful for
+ * checking that a code path does not allocate.
+ *
+ * Returns: number of allocations
+ */
+unsigned long ck_alloc_count();
+
+
 #endif